@@ -0,0 +1,113 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/insomnia.hpp"
+#include "insomnia/internal/swap_tracker.hpp"
+#include "spike/io/binreader_stream.hpp"
+#include "synthetic_ighw.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+static constexpr uint32 NUM_ITEMS = 1'000'000;
+static constexpr size_t NUM_RUNS = 5;
+
+template <class Fn> static double BestOf(Fn &&fn) {
+  double best = 1e30;
+
+  for (size_t r = 0; r < NUM_RUNS; r++) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+
+  return best;
+}
+
+// Swapped class tracking before (std::set) and after (SwapTracker), same
+// address pattern as fixupper sees for single array entry.
+static void BenchTrackers(const std::string &ighw) {
+  std::vector<char> buffer(ighw.begin(), ighw.end());
+  char *base = buffer.data();
+  char *data = base + sizeof(IGHWHeader) + sizeof(IGHWTOC);
+  size_t numMarked = 0;
+
+  const double setMs = BestOf([&] {
+    std::set<void *> swapped;
+
+    for (uint32 i = 0; i < NUM_ITEMS; i++) {
+      numMarked += swapped.emplace(data + i * sizeof(Texture)).second;
+    }
+  });
+
+  const double bitmapMs = BestOf([&] {
+    std::vector<uint64> marks((buffer.size() / 4 + 63) / 64);
+    SwapTracker tracker{base, marks, false};
+
+    for (uint32 i = 0; i < NUM_ITEMS; i++) {
+      numMarked += tracker.Mark(data + i * sizeof(Texture));
+    }
+  });
+
+  printf("tracker std::set:    %8.2f ms\n", setMs);
+  printf("tracker SwapTracker: %8.2f ms\n", bitmapMs);
+  printf("(%zu marks)\n", numMarked);
+}
+
+template <class C> static void BenchFromStream(const char *name) {
+  const std::string ighw = MakeSyntheticIGHW<C>(NUM_ITEMS);
+  std::atomic<size_t> sink = 0;
+
+  const double loadMs = BestOf([&] {
+    std::istringstream str(ighw);
+    IGHW main;
+    BinReaderRef_e rd(str);
+    main.FromStream(rd, Version::V2);
+    sink += std::as_const(main).Header()->dataEnd;
+  });
+
+  const double fixupMs = BestOf([&] {
+    std::istringstream str(ighw);
+    IGHW main;
+    BinReaderRef_e rd(str);
+    main.FromStream(rd, Version::V2);
+
+    for (const IGHWTOC &toc : main) {
+      main.Fixup(toc);
+      sink += toc.Iter<C>().begin() != toc.Iter<C>().end();
+    }
+  });
+
+  printf("%s x %u, %.1f MiB\n", name, NUM_ITEMS,
+         ighw.size() / double(1 << 20));
+  printf("  FromStream:         %8.2f ms\n", loadMs);
+  printf("  FromStream + Fixup: %8.2f ms\n", fixupMs);
+}
+
+int main() {
+  BenchFromStream<Texture>("Texture");
+  BenchFromStream<TextureResource>("TextureResource");
+  BenchTrackers(MakeSyntheticIGHW<Texture>(NUM_ITEMS));
+  return 0;
+}
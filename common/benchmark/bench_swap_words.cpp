@@ -0,0 +1,50 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/swap_words.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static constexpr size_t BUFFER_SIZE = 64 << 20;
+static constexpr size_t NUM_RUNS = 10;
+
+int main() {
+  std::vector<char> buffer(BUFFER_SIZE);
+
+  for (size_t i = 0; i < buffer.size(); i++) {
+    buffer[i] = char(i);
+  }
+
+  for (const SwapWordsKernel &kernel : SwapWordsKernels()) {
+    double best = 1e30;
+
+    for (size_t r = 0; r < NUM_RUNS; r++) {
+      const auto start = std::chrono::steady_clock::now();
+      kernel.fn(buffer.data(), buffer.data() + buffer.size());
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+
+    printf("%-8s %6.2f GB/s\n", kernel.name, buffer.size() / best / 1e9);
+  }
+
+  printf("(checksum %d)\n", int(buffer[BUFFER_SIZE / 2]));
+  return 0;
+}
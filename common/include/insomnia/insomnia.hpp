@@ -26,10 +26,18 @@
 #include "classes/sound.hpp"
 #include "classes/tie.hpp"
 #include "classes/zone.hpp"
+#include "internal/mapped_file.hpp"
 #include "internal/settings.hpp"
 #include "spike/io/bincore_fwd.hpp"
 #include "spike/type/bitfield.hpp"
+#include <algorithm>
+#include <iosfwd>
+#include <list>
+#include <memory>
+#include <span>
+#include <string_view>
 #include <typeinfo>
+#include <vector>
 
 static const float YARD_TO_M = 0.9144;
 static const float M_TO_YARD = 1 / YARD_TO_M;
@@ -118,12 +126,44 @@ enum class Version {
 };
 
 struct IGHW {
+  // Threads used for pointer fixups and FixupAll, 0 = all cores
+  uint32 numThreads = 1;
+
   void IS_EXTERN FromStream(BinReaderRef_e rd, Version version);
-  auto Header() const {
-    return reinterpret_cast<const IGHWHeader *>(buffer.data());
-  }
+  // Reads header, TOC and data of classes with given ids only.
+  // Data pointed from loaded classes is read as well.
+  // Find ignores entries that were not loaded.
+  // Version 0 files are loaded whole.
+  void IS_EXTERN FromStream(BinReaderRef_e rd, Version version,
+                            std::span<const uint32> classIds);
+  // Maps [offset, offset + size) of file copy on write instead of reading
+  // it into buffer, size 0 maps until end of file.
+  // Returns false when file cannot be mapped.
+  bool IS_EXTERN FromFile(const std::string &path, size_t offset, size_t size,
+                          Version version);
+  // Copies data read in file endianness, data is left untouched.
+  void IS_EXTERN FromMemory(std::string_view data, Version version);
+  // Maps fixed up native endian copy from cacheDir when its key matches
+  // source path, offset, size and modification time. Otherwise loads
+  // source with FromFile, fixups every class and stores the copy.
+  // Empty cacheDir behaves like FromFile.
+  bool IS_EXTERN FromCache(const std::string &cacheDir,
+                           const std::string &path, size_t offset, size_t size,
+                           Version version);
+  // Same as above for source range already read into data.
+  // Data is parsed with FromMemory instead of loading source again.
+  bool IS_EXTERN FromCache(const std::string &cacheDir,
+                           const std::string &path, size_t offset,
+                           std::string_view data, Version version);
+  // Byteswaps classes of TOC entry and every entry it points into.
+  // Class data is kept in file endianness until first call.
+  // CatchClasses calls this for every catched class.
+  void IS_EXTERN Fixup(const IGHWTOC &toc);
+  // Byteswaps every class, work is split by TOC entries.
+  void IS_EXTERN FixupAll();
+  auto Header() const { return reinterpret_cast<const IGHWHeader *>(base); }
   auto begin() const {
-    return reinterpret_cast<const IGHWTOC *>(buffer.data() + tocOffset);
+    return reinterpret_cast<const IGHWTOC *>(base + tocOffset);
   }
   auto end() const {
     return reinterpret_cast<const IGHWTOC *>(begin() + Header()->numToc);
@@ -135,37 +175,167 @@ struct IGHW {
     return const_cast<IGHWTOC *>(static_cast<const IGHW *>(this)->end());
   }
 
+  // Returns first TOC entry with given id or nullptr
+  const IGHWTOC *Find(uint32 id) const {
+    auto found = FindIndex(id);
+    return found.first == found.second ? nullptr
+                                       : begin() + found.first->second;
+  }
+
+  // Returns first TOC entry with class id and matching array stride
+  template <class C> const IGHWTOC *Find() const {
+    auto [first, last] = FindIndex(C::ID);
+
+    for (; first != last; first++) {
+      const IGHWTOC *toc = begin() + first->second;
+
+      if (toc->count.ArrayType() != IGHWTOCArrayType::Array ||
+          toc->size == sizeof(C)) {
+        return toc;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Calls cb for every TOC entry with given id, in TOC order
+  template <class CB> void ForEach(uint32 id, CB &&cb) const {
+    auto [first, last] = FindIndex(id);
+
+    for (; first != last; first++) {
+      cb(*(begin() + first->second));
+    }
+  }
+
+  // Fixups class, returns empty iterator when class is not present
+  template <class C> IGHWTOCIteratorConst<C> TryIter() {
+    const IGHWTOC *toc = Find<C>();
+
+    if (!toc) {
+      return {};
+    }
+
+    Fixup(*toc);
+    return toc->Iter<C>();
+  }
+
 private:
-  auto Header() { return reinterpret_cast<IGHWHeader *>(buffer.data()); }
+  auto Header() { return reinterpret_cast<IGHWHeader *>(base); }
+  void Setup(const IGHWHeader &hdr, std::span<const uint32> fixups,
+             Version version_);
+  void FixupToc(uint32 index, bool concurrent);
+  // data.data() == nullptr loads source with FromFile
+  bool LoadCached(const std::string &cacheDir, const std::string &path,
+                  size_t offset, size_t size, Version version,
+                  std::string_view data);
+  void BuildTocIndex();
+  using TocIndex = std::vector<std::pair<uint32, uint32>>;
+  std::pair<TocIndex::const_iterator, TocIndex::const_iterator>
+  FindIndex(uint32 id) const {
+    return std::equal_range(
+        tocIndex.begin(), tocIndex.end(), std::make_pair(id, uint32(0)),
+        [](auto &a, auto &b) { return a.first < b.first; });
+  }
   std::string buffer;
+  MappedFile mapping;
+  char *base = nullptr;
   uint32 tocOffset = sizeof(IGHWHeader);
+  Version version;
+  std::vector<uint8> fixedToc;
+  // sorted pairs of [class id, toc index]
+  TocIndex tocIndex;
+  // sorted pairs of [toc index, pointed toc index]
+  std::vector<std::pair<uint32, uint32>> tocDeps;
+  // bit per 4 bytes of data, allocated on first Fixup
+  std::vector<uint64> swapped;
+  uint32 dataEnd = 0;
 };
 
-template <class... C, class CB>
-void CatchClassesLambda(IGHW &main, CB &&callback,
-                        IGHWTOCIteratorConst<C> &...classes) {
-  bool catched = false;
-  [[maybe_unused]] auto CatchClass = [&](const IGHWTOC &toc, auto &item) {
+// Reads raw TOC entry data on demand, nothing is swapped or fixed up.
+// Used for big vertex/index buffers that don't have to be kept in memory.
+// Loaded windows are cached, least recently used are dropped first
+// when memoryLimit is exceeded.
+struct IGHWWindowReader {
+  struct Entry {
+    uint32 id;
+    uint32 offset;
+    uint32 size;
+  };
+
+  size_t memoryLimit = 64 * 1024 * 1024;
+  // Windows are aligned to this size
+  size_t windowSize = 1024 * 1024;
+
+  // Reads header and TOC at current stream position.
+  // Stream must outlive reader.
+  void IS_EXTERN FromStream(std::istream &stream);
+  // Uses whole IGHW in memory, windows point into data without copying.
+  // Data must be in file endianness and outlive reader.
+  void IS_EXTERN FromMemory(std::string_view data);
+  // Returns first TOC entry with given id or nullptr
+  const Entry *Find(uint32 id) const {
+    auto found = std::lower_bound(
+        entries.begin(), entries.end(), id,
+        [](const Entry &item, uint32 id) { return item.id < id; });
+    return found == entries.end() || found->id != id ? nullptr : &*found;
+  }
+  // Returns bytes [offset, offset + size) of entry data.
+  // Memory stays valid while returned pointer is held.
+  // Throws std::out_of_range when range is not within entry size.
+  std::shared_ptr<const char> IS_EXTERN Window(const Entry &entry,
+                                               size_t offset, size_t size);
+
+  // Copies count of T at byte offset of entry data
+  template <class T>
+  std::vector<T> Read(const Entry &entry, size_t offset, size_t count) {
+    auto window = Window(entry, offset, count * sizeof(T));
+    const T *data = reinterpret_cast<const T *>(window.get());
+    return {data, data + count};
+  }
+
+private:
+  struct Block {
+    size_t begin;
+    size_t end;
+    std::shared_ptr<std::string> data;
+  };
+  void BuildEntries(const IGHWHeader &hdr, std::vector<IGHWTOC> &toc);
+  std::istream *stream = nullptr;
+  const char *memory = nullptr;
+  size_t origin = 0;
+  size_t dataEnd = 0;
+  // sorted by id
+  std::vector<Entry> entries;
+  // most recently used first
+  std::list<Block> windows;
+  size_t cachedSize = 0;
+};
+
+// Every TOC entry with class id is catched, last one is kept.
+// Throws std::bad_cast when array stride doesn't match class.
+template <class... C>
+void CatchClasses(IGHW &main, IGHWTOCIteratorConst<C> &...classes) {
+  [[maybe_unused]] auto CatchClass = [&](auto &item) {
     using type = typename std::remove_reference_t<decltype(item)>::value_type;
-    if (toc.IsClass<type>()) {
+    main.ForEach(type::ID, [&](const IGHWTOC &toc) {
+      main.Fixup(toc);
       item = toc.Iter<type>();
-      catched = true;
-    }
+    });
   };
 
-  for (auto &i : main) {
-    (CatchClass(i, classes), ...);
+  (CatchClass(classes), ...);
+}
 
-    if (catched) {
-      catched = false;
-    } else {
+// Calls callback for every TOC entry that is not one of catched classes.
+// Classes are catched before first callback.
+template <class... C, class CB>
+void CatchClassesLambda(IGHW &main, CB &&callback,
+                        IGHWTOCIteratorConst<C> &...classes) {
+  CatchClasses(main, classes...);
+
+  for (auto &i : main) {
+    if (!((i.id == C::ID) || ...)) {
       callback(i);
     }
   }
 }
-
-template <class... C>
-void CatchClasses(IGHW &main, IGHWTOCIteratorConst<C> &...classes) {
-  auto dummy = [](const IGHWTOC &) {};
-  CatchClassesLambda(main, dummy, classes...);
-}
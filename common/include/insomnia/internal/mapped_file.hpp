@@ -0,0 +1,54 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/internal/settings.hpp"
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// Maps file range into memory.
+// Copy on write mappings are private, only written pages are duplicated.
+struct MappedFile {
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) {
+    std::swap(base, other.base);
+    std::swap(baseSize, other.baseSize);
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+  ~MappedFile() { Close(); }
+
+  // size == 0 maps until end of file
+  // returns false when file cannot be mapped
+  bool IS_EXTERN Open(const std::string &path, size_t offset = 0,
+                      size_t size = 0, bool copyOnWrite = false);
+  void IS_EXTERN Close();
+
+  char *Data() const { return data; }
+  size_t Size() const { return size; }
+  explicit operator bool() const { return data; }
+
+private:
+  void *base = nullptr;
+  size_t baseSize = 0;
+  char *data = nullptr;
+  size_t size = 0;
+};
@@ -0,0 +1,140 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Splits [0, numItems) into contiguous chunks and calls fn(begin, end)
+// for every chunk on its own thread. Calling thread processes first chunk.
+// numThreads == 0 uses all cores.
+template <class Fn>
+void ParallelFor(size_t numItems, size_t numThreads, Fn &&fn) {
+  if (!numThreads) {
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  numThreads = std::min(numThreads, numItems);
+
+  if (numThreads < 2) {
+    if (numItems) {
+      fn(size_t(0), numItems);
+    }
+
+    return;
+  }
+
+  const size_t chunkSize = (numItems + numThreads - 1) / numThreads;
+  numThreads = (numItems + chunkSize - 1) / chunkSize;
+  std::vector<std::exception_ptr> errors(numThreads);
+
+  auto Run = [&](size_t index) {
+    try {
+      fn(index * chunkSize, std::min(numItems, (index + 1) * chunkSize));
+    } catch (...) {
+      errors[index] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+
+  for (size_t t = 1; t < numThreads; t++) {
+    workers.emplace_back(Run, t);
+  }
+
+  Run(0);
+
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  for (auto &e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+// Runs every task on its own thread as soon as its dependencies are done.
+// Tasks depending on failed task are not run, Run rethrows first error
+// in order of Add.
+struct TaskGraph {
+  using Task = size_t;
+
+  // Dependencies must be added first, so graph can't have cycles
+  template <class Fn> Task Add(Fn &&fn, std::vector<Task> deps = {}) {
+    for (Task dep : deps) {
+      if (dep >= tasks.size()) {
+        throw std::out_of_range("Task dependency not added yet.");
+      }
+    }
+
+    tasks.push_back({std::forward<Fn>(fn), std::move(deps)});
+    return tasks.size() - 1;
+  }
+
+  void Run() {
+    std::vector<std::promise<void>> promises(tasks.size());
+    std::vector<std::shared_future<void>> done;
+
+    for (auto &p : promises) {
+      done.emplace_back(p.get_future().share());
+    }
+
+    auto RunTask = [&](Task index) {
+      try {
+        for (Task dep : tasks[index].deps) {
+          done[dep].get();
+        }
+
+        tasks[index].fn();
+        promises[index].set_value();
+      } catch (...) {
+        promises[index].set_exception(std::current_exception());
+      }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (Task t = 0; t < tasks.size(); t++) {
+      workers.emplace_back(RunTask, t);
+    }
+
+    for (auto &w : workers) {
+      w.join();
+    }
+
+    tasks.clear();
+
+    for (auto &d : done) {
+      d.get();
+    }
+  }
+
+private:
+  struct Node {
+    std::function<void()> fn;
+    std::vector<Task> deps;
+  };
+
+  std::vector<Node> tasks;
+};
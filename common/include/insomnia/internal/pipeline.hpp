@@ -0,0 +1,237 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Limits workers busy at once across every pipeline sharing it.
+struct WorkerBudget {
+  // 0 = all cores
+  explicit WorkerBudget(size_t numSlots_) : numSlots(numSlots_) {
+    if (!numSlots) {
+      numSlots = std::max(1U, std::thread::hardware_concurrency());
+    }
+  }
+
+  size_t Size() const { return numSlots; }
+
+  // Holds one slot for its lifetime, null budget is unlimited
+  struct Slot {
+    explicit Slot(WorkerBudget *budget_) : budget(budget_) {
+      if (budget) {
+        std::unique_lock lock(budget->mutex);
+        budget->released.wait(
+            lock, [&] { return budget->numUsed < budget->numSlots; });
+        budget->numUsed++;
+      }
+    }
+    Slot(const Slot &) = delete;
+    ~Slot() {
+      if (budget) {
+        std::lock_guard lock(budget->mutex);
+        budget->numUsed--;
+        budget->released.notify_one();
+      }
+    }
+
+  private:
+    WorkerBudget *budget;
+  };
+
+private:
+  std::mutex mutex;
+  std::condition_variable released;
+  size_t numSlots;
+  size_t numUsed = 0;
+};
+
+struct PipelineOptions {
+  // 0 = all cores
+  size_t numWorkers = 1;
+  // Shared with concurrent pipelines, work calls take a slot each.
+  // numWorkers is capped to its size.
+  WorkerBudget *budget = nullptr;
+  // Items read but not written yet, 0 = 4 per worker
+  size_t queueDepth = 0;
+  // Bytes of read items not written yet, first item is always let through
+  size_t memoryLimit = 512 * 1024 * 1024;
+};
+
+// Runs items [0, numItems) through stages:
+//   read(index) -> Input on reader thread, in order
+//   work(index, Input &) -> Output on numWorkers threads
+//   write(index, Output &) on calling thread, in order
+// makeWorker() is called once per worker thread and returns its work
+// callable, so workers can keep their own streams and buffers.
+// Input must have size(), it's counted against memoryLimit until written.
+// First exception stops every stage and is rethrown.
+template <class Read, class MakeWorker, class Write>
+void RunPipeline(size_t numItems, PipelineOptions options, Read &&read,
+                 MakeWorker &&makeWorker, Write &&write) {
+  using Input = decltype(read(size_t(0)));
+  using Worker = decltype(makeWorker());
+  using Output =
+      decltype(std::declval<Worker &>()(size_t(0), std::declval<Input &>()));
+
+  if (!numItems) {
+    return;
+  }
+
+  if (!options.numWorkers) {
+    options.numWorkers = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  if (options.budget) {
+    options.numWorkers = std::min(options.numWorkers, options.budget->Size());
+  }
+
+  options.numWorkers = std::min(options.numWorkers, numItems);
+
+  if (!options.queueDepth) {
+    options.queueDepth = options.numWorkers * 4;
+  }
+
+  std::mutex mutex;
+  std::condition_variable readerWait;
+  std::condition_variable workerWait;
+  std::condition_variable writerWait;
+  std::deque<std::pair<size_t, Input>> inputs;
+  std::map<size_t, Output> outputs;
+  std::vector<size_t> inputSizes(numItems);
+  size_t numRead = 0;
+  size_t numWritten = 0;
+  size_t bytesInFlight = 0;
+  std::exception_ptr error;
+
+  auto Fail = [&] {
+    std::lock_guard lock(mutex);
+
+    if (!error) {
+      error = std::current_exception();
+    }
+
+    readerWait.notify_all();
+    workerWait.notify_all();
+    writerWait.notify_all();
+  };
+
+  std::thread reader([&] {
+    try {
+      for (size_t i = 0; i < numItems; i++) {
+        {
+          std::unique_lock lock(mutex);
+          readerWait.wait(lock, [&] {
+            const size_t inFlight = numRead - numWritten;
+            return error || inFlight == 0 ||
+                   (inFlight < options.queueDepth &&
+                    bytesInFlight < options.memoryLimit);
+          });
+
+          if (error) {
+            return;
+          }
+        }
+
+        Input input = read(i);
+        std::lock_guard lock(mutex);
+        inputSizes[i] = input.size();
+        bytesInFlight += inputSizes[i];
+        inputs.emplace_back(i, std::move(input));
+        numRead++;
+        workerWait.notify_one();
+      }
+    } catch (...) {
+      Fail();
+    }
+
+    std::lock_guard lock(mutex);
+    workerWait.notify_all();
+  });
+
+  std::vector<std::thread> workers;
+
+  for (size_t w = 0; w < options.numWorkers; w++) {
+    workers.emplace_back([&] {
+      try {
+        Worker work = makeWorker();
+
+        while (true) {
+          std::unique_lock lock(mutex);
+          workerWait.wait(lock, [&] {
+            return error || !inputs.empty() || numRead == numItems;
+          });
+
+          if (error || inputs.empty()) {
+            return;
+          }
+
+          auto [index, input] = std::move(inputs.front());
+          inputs.pop_front();
+          lock.unlock();
+          Output output = [&] {
+            WorkerBudget::Slot slot(options.budget);
+            return work(index, input);
+          }();
+          lock.lock();
+          outputs.emplace(index, std::move(output));
+          writerWait.notify_one();
+        }
+      } catch (...) {
+        Fail();
+      }
+    });
+  }
+
+  try {
+    for (size_t i = 0; i < numItems; i++) {
+      std::unique_lock lock(mutex);
+      writerWait.wait(lock, [&] { return error || outputs.count(i); });
+
+      if (error) {
+        break;
+      }
+
+      auto node = outputs.extract(i);
+      lock.unlock();
+      write(i, node.mapped());
+      lock.lock();
+      numWritten++;
+      bytesInFlight -= inputSizes[i];
+      readerWait.notify_one();
+    }
+  } catch (...) {
+    Fail();
+  }
+
+  reader.join();
+
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,114 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/except.hpp"
+#include <algorithm>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Collects reads of single file, then reads them sorted by offset.
+// Ranges closer than maxGap are merged into single read.
+// Data is returned by request index, so callers keep their own order.
+struct ReadPlanner {
+  // Gap bytes are cheaper to read than to seek over
+  size_t maxGap = 0x10000;
+  // Full() hint for callers reading in batches
+  size_t batchLimit = 0x4000000;
+
+  // Returns request index for Get
+  size_t Add(size_t offset, size_t size) {
+    requests.push_back({offset, size});
+    pendingSize += size;
+    return requests.size() - 1;
+  }
+
+  bool Full() const { return pendingSize >= batchLimit; }
+  bool Empty() const { return requests.empty(); }
+
+  // Reads every request added since last Clear
+  void Read(std::istream &stream) {
+    std::vector<size_t> order(requests.size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return requests[a].offset < requests[b].offset;
+    });
+
+    blocks.clear();
+
+    for (size_t i = 0; i < order.size();) {
+      const size_t blockBegin = requests[order[i]].offset;
+      size_t blockEnd = blockBegin;
+      size_t last = i;
+
+      for (; last < order.size(); last++) {
+        const Request &req = requests[order[last]];
+
+        if (req.offset > blockEnd + maxGap && last > i) {
+          break;
+        }
+
+        blockEnd = std::max(blockEnd, req.offset + req.size);
+      }
+
+      for (; i < last; i++) {
+        Request &req = requests[order[i]];
+        req.block = blocks.size();
+        req.blockOffset = req.offset - blockBegin;
+      }
+
+      std::string &block = blocks.emplace_back();
+      block.resize(blockEnd - blockBegin);
+      stream.clear();
+      stream.seekg(blockBegin);
+      stream.read(block.data(), block.size());
+
+      if (!stream) {
+        throw es::UnexpectedEOS();
+      }
+    }
+  }
+
+  std::string_view Get(size_t index) const {
+    const Request &req = requests.at(index);
+    return {blocks.at(req.block).data() + req.blockOffset, req.size};
+  }
+
+  void Clear() {
+    requests.clear();
+    blocks.clear();
+    pendingSize = 0;
+  }
+
+private:
+  struct Request {
+    size_t offset;
+    size_t size;
+    size_t block = 0;
+    size_t blockOffset = 0;
+  };
+
+  std::vector<Request> requests;
+  std::vector<std::string> blocks;
+  size_t pendingSize = 0;
+};
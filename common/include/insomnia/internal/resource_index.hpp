@@ -0,0 +1,86 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/insomnia.hpp"
+#include <algorithm>
+#include <vector>
+
+// Binary searchable view of ResourceLookup table.
+// Tables are not sorted in files, so sorted indices are kept aside.
+// Find returns first match in table order, same as linear search did.
+template <class C> struct ResourceIndex {
+  ResourceIndex() = default;
+  explicit ResourceIndex(IGHWTOCIteratorConst<C> items_) : items(items_) {
+    const uint32 numItems = std::distance(items.begin(), items.end());
+    byHash.resize(numItems);
+
+    for (uint32 i = 0; i < numItems; i++) {
+      byHash[i] = i;
+    }
+
+    byPart2 = byHash;
+    const C *data = items.begin();
+
+    std::stable_sort(byHash.begin(), byHash.end(), [data](uint32 a, uint32 b) {
+      return data[a].hash < data[b].hash;
+    });
+
+    std::stable_sort(
+        byPart2.begin(), byPart2.end(), [data](uint32 a, uint32 b) {
+          return data[a].hash.part2 < data[b].hash.part2;
+        });
+  }
+
+  // Returns nullptr when not found
+  const C *Find(Hash hash) const {
+    const C *data = items.begin();
+    auto found = std::lower_bound(
+        byHash.begin(), byHash.end(), hash,
+        [data](uint32 index, Hash hash) { return data[index].hash < hash; });
+
+    if (found == byHash.end() || !(data[*found].hash == hash)) {
+      return nullptr;
+    }
+
+    return data + *found;
+  }
+
+  // Lookup by second part of hash only, returns nullptr when not found
+  const C *Find(uint32 part2) const {
+    const C *data = items.begin();
+    auto found = std::lower_bound(byPart2.begin(), byPart2.end(), part2,
+                                  [data](uint32 index, uint32 part2) {
+                                    return data[index].hash.part2 < part2;
+                                  });
+
+    if (found == byPart2.end() || data[*found].hash.part2 != part2) {
+      return nullptr;
+    }
+
+    return data + *found;
+  }
+
+  auto begin() const { return items.begin(); }
+  auto end() const { return items.end(); }
+  bool Valid() const { return items.Valid(); }
+
+private:
+  IGHWTOCIteratorConst<C> items;
+  std::vector<uint32> byHash;
+  std::vector<uint32> byPart2;
+};
@@ -0,0 +1,47 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/util/supercore.hpp"
+#include <atomic>
+#include <vector>
+
+// Offset indexed bitmap of swapped classes.
+// Classes are at least 4 bytes long, so one bit per 4 bytes is enough.
+struct SwapTracker {
+  char *base;
+  std::vector<uint64> &marks;
+  bool concurrent;
+
+  // Returns false when data was already marked.
+  bool Mark(void *data) {
+    const size_t index = (static_cast<char *>(data) - base) / 4;
+    uint64 &block = marks.at(index / 64);
+    const uint64 bit = uint64(1) << (index % 64);
+
+    if (concurrent) {
+      return !(std::atomic_ref<uint64>(block).fetch_or(bit) & bit);
+    }
+
+    if (block & bit) {
+      return false;
+    }
+
+    block |= bit;
+    return true;
+  }
+};
@@ -0,0 +1,31 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/internal/settings.hpp"
+#include <span>
+
+// Swaps every 32bit word in [begin, end), unaligned.
+using SwapWordsFn = void (*)(char *begin, char *end);
+
+struct SwapWordsKernel {
+  const char *name;
+  SwapWordsFn fn;
+};
+
+// Kernels supported by running CPU, fastest is last.
+std::span<const SwapWordsKernel> IS_EXTERN SwapWordsKernels();
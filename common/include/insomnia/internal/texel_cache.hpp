@@ -0,0 +1,271 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/internal/texture.hpp"
+#include "spike/util/supercore.hpp"
+#include <bit>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+
+// XXH64 of data, input is read as little endian
+inline uint64 XXH64(std::string_view data, uint64 seed = 0) {
+  static constexpr uint64 P1 = 0x9E3779B185EBCA87ULL;
+  static constexpr uint64 P2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr uint64 P3 = 0x165667B19E3779F9ULL;
+  static constexpr uint64 P4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr uint64 P5 = 0x27D4EB2F165667C5ULL;
+
+  auto Read64 = [](const char *p) {
+    uint64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  };
+
+  auto Read32 = [](const char *p) {
+    uint32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  };
+
+  auto Round = [](uint64 acc, uint64 input) {
+    acc += input * P2;
+    return std::rotl(acc, 31) * P1;
+  };
+
+  auto MergeRound = [&](uint64 acc, uint64 val) {
+    acc ^= Round(0, val);
+    return acc * P1 + P4;
+  };
+
+  const char *p = data.data();
+  const char *end = p + data.size();
+  uint64 h;
+
+  if (data.size() >= 32) {
+    uint64 v1 = seed + P1 + P2;
+    uint64 v2 = seed + P2;
+    uint64 v3 = seed;
+    uint64 v4 = seed - P1;
+
+    for (; p + 32 <= end; p += 32) {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+    }
+
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+        std::rotl(v4, 18);
+    h = MergeRound(h, v1);
+    h = MergeRound(h, v2);
+    h = MergeRound(h, v3);
+    h = MergeRound(h, v4);
+  } else {
+    h = seed + P5;
+  }
+
+  h += data.size();
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = std::rotl(h, 27) * P1 + P4;
+  }
+
+  if (p + 4 <= end) {
+    h ^= uint64(Read32(p)) * P1;
+    h = std::rotl(h, 23) * P2 + P3;
+    p += 4;
+  }
+
+  for (; p < end; p++) {
+    h ^= uint8(*p) * P5;
+    h = std::rotl(h, 11) * P1;
+  }
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+// Identifies output of NewImage, format is formatOverride passed to it,
+// mode is tool specific output mode.
+// Format chosen in app config for TexelContextFormat::Config is not visible
+// to modules, cache must be cleared after changing it.
+inline uint64 TexelOutputFormatKey(TexelContextFormat format, uint32 mode,
+                                   bool embed) {
+  const uint32 values[]{uint32(format), mode, embed};
+  return XXH64({reinterpret_cast<const char *>(values), sizeof(values)});
+}
+
+// Converted textures stored by raw payload and conversion parameters,
+// so same texture is converted once across files and runs.
+struct TexelCache {
+  explicit TexelCache(std::string cacheDir_)
+      : cacheDir(std::move(cacheDir_)) {}
+
+  bool Enabled() const { return !cacheDir.empty(); }
+
+  // outputFormat comes from TexelOutputFormatKey, params must hold
+  // everything else besides payload that changes output
+  static uint64 Key(std::string_view payload, uint64 outputFormat,
+                    std::span<const uint32> params) {
+    const uint64 paramsHash =
+        XXH64({reinterpret_cast<const char *>(params.data()),
+               params.size_bytes()},
+              outputFormat);
+    return XXH64(payload, paramsHash);
+  }
+
+  // File paths are stored relative to extensionless path,
+  // so cached files can be reused under different names.
+  // Returns false when not cached.
+  bool Load(uint64 key, const std::string &path,
+            TexelMemoryOutput &output) const {
+    if (!Enabled()) {
+      return false;
+    }
+
+    std::ifstream str(CachePath(key), std::ios::binary);
+
+    if (!str) {
+      return false;
+    }
+
+    Header hdr;
+    str.read(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+
+    if (!str || hdr.id != Header::ID || hdr.version != Header::VERSION ||
+        hdr.key != key) {
+      return false;
+    }
+
+    const std::string stem = Stem(path);
+    std::vector<TexelMemoryOutput::File> files(hdr.numFiles);
+
+    for (TexelMemoryOutput::File &f : files) {
+      uint32 sizes[2];
+      str.read(reinterpret_cast<char *>(sizes), sizeof(sizes));
+
+      if (!str) {
+        return false;
+      }
+
+      f.path.resize(sizes[0]);
+      f.data.resize(sizes[1]);
+      str.read(f.path.data(), f.path.size());
+      str.read(f.data.data(), f.data.size());
+      f.path.insert(0, stem);
+    }
+
+    if (!str) {
+      return false;
+    }
+
+    output.files = std::move(files);
+    return true;
+  }
+
+  void Store(uint64 key, const std::string &path,
+             const TexelMemoryOutput &output) const {
+    if (!Enabled()) {
+      return;
+    }
+
+    const std::string stem = Stem(path);
+
+    for (const TexelMemoryOutput::File &f : output.files) {
+      if (!f.path.starts_with(stem)) {
+        return;
+      }
+    }
+
+    // Write into temporary file first, so concurrent runs never read
+    // partially written entry.
+    const std::string cachePath = CachePath(key);
+    const std::string tempPath =
+        cachePath + "." + std::to_string(std::random_device{}());
+    std::error_code ec;
+
+    {
+      std::filesystem::create_directories(cacheDir, ec);
+      std::ofstream str(tempPath, std::ios::binary);
+      Header hdr;
+      hdr.key = key;
+      hdr.numFiles = output.files.size();
+      str.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+
+      for (const TexelMemoryOutput::File &f : output.files) {
+        const uint32 sizes[2]{uint32(f.path.size() - stem.size()),
+                              uint32(f.data.size())};
+        str.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+        str.write(f.path.data() + stem.size(), sizes[0]);
+        str.write(f.data.data(), f.data.size());
+      }
+
+      if (!str) {
+        str.close();
+        std::filesystem::remove(tempPath, ec);
+        return;
+      }
+    }
+
+    std::filesystem::rename(tempPath, cachePath, ec);
+
+    if (ec) {
+      std::filesystem::remove(tempPath, ec);
+    }
+  }
+
+private:
+  struct Header {
+    static constexpr uint32 ID = CompileFourCC("IGTC");
+    static constexpr uint32 VERSION = 2;
+    uint32 id = ID;
+    uint32 version = VERSION;
+    uint64 key = 0;
+    uint32 numFiles = 0;
+    uint32 reserved = 0;
+  };
+
+  std::string cacheDir;
+
+  std::string CachePath(uint64 key) const {
+    char cacheName[0x20];
+    snprintf(cacheName, sizeof(cacheName), "%.16" PRIX64 ".igtc", key);
+    return (std::filesystem::path(cacheDir) / cacheName).string();
+  }
+
+  static std::string Stem(const std::string &path) {
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of("/\\");
+
+    if (dot == path.npos || (slash != path.npos && dot < slash)) {
+      return path;
+    }
+
+    return path.substr(0, dot);
+  }
+};
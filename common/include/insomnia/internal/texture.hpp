@@ -0,0 +1,283 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/classes/shader.hpp"
+#include "spike/app_context.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bytes of texel data of every mip, volume slice and cubemap face.
+// Compressed formats are stored in 4x4 blocks, rest are swizzled without
+// row padding. Cubemap faces are 128 byte aligned.
+// Volume depth is not halved for mips, volume sizes are upper bound.
+// Returns 0 for unknown format.
+inline size_t TexturePayloadSize(const Texture &tex) {
+  using T = TextureFormat;
+  size_t blockSize = 0;
+  bool isCompressed = false;
+
+  switch (tex.format) {
+  case T::R8:
+    blockSize = 1;
+    break;
+  case T::RGB5A1:
+  case T::RGBA4:
+  case T::R5G6B5:
+  case T::RG8:
+    blockSize = 2;
+    break;
+  case T::RGBA8:
+    blockSize = 4;
+    break;
+  case T::BC1:
+    blockSize = 8;
+    isCompressed = true;
+    break;
+  case T::BC2:
+  case T::BC3:
+    blockSize = 16;
+    isCompressed = true;
+    break;
+  default:
+    return 0;
+  }
+
+  const size_t depth = std::max(
+      size_t(1), size_t(tex.control3.Get<TextureControl3::depth>()));
+  const size_t numMips = std::max(uint16(1), tex.numMips);
+  size_t width = std::max(uint16(1), tex.width);
+  size_t height = std::max(uint16(1), tex.height);
+  size_t faceSize = 0;
+
+  for (size_t m = 0; m < numMips; m++) {
+    if (isCompressed) {
+      faceSize += ((width + 3) / 4) * ((height + 3) / 4) * blockSize * depth;
+    } else {
+      faceSize += width * height * blockSize * depth;
+    }
+
+    width = std::max(width / 2, size_t(1));
+    height = std::max(height / 2, size_t(1));
+  }
+
+  if (!tex.flags.Get<TextureFlags::isCubemap>()) {
+    return faceSize;
+  }
+
+  return ((faceSize + 127) & ~size_t(127)) * 6;
+}
+
+// Decides from raw payload if any texel can decode with non zero blue.
+// BC blocks are checked by endpoints actually referenced by indices,
+// other formats are only known empty when all bytes are zero.
+// swapPacked must match decoder, see SwapPackedBlocks.
+// False result is exact, true result may still decode as empty.
+inline bool HasNonZeroBlue(const Texture &tex, std::string_view data,
+                           bool swapPacked) {
+  using T = TextureFormat;
+  size_t colorOffset = 8;
+  bool has3Colors = false;
+
+  switch (tex.format) {
+  case T::BC1:
+    colorOffset = 0;
+    has3Colors = true;
+    break;
+  case T::BC2:
+  case T::BC3:
+    break;
+  default: {
+    uint64 accum = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= data.size(); i += 8) {
+      uint64 word;
+      memcpy(&word, data.data() + i, sizeof(word));
+      accum |= word;
+    }
+
+    for (; i < data.size(); i++) {
+      accum |= uint8(data[i]);
+    }
+
+    return accum;
+  }
+  }
+
+  const size_t blockSize = colorOffset + 8;
+
+  for (size_t b = 0; b + blockSize <= data.size(); b += blockSize) {
+    char block[8];
+    memcpy(block, data.data() + b + colorOffset, sizeof(block));
+
+    if (swapPacked) {
+      for (size_t i = 0; i < sizeof(block); i += 2) {
+        std::swap(block[i], block[i + 1]);
+      }
+    }
+
+    uint16 color0;
+    uint16 color1;
+    uint32 indices;
+    memcpy(&color0, block, 2);
+    memcpy(&color1, block + 2, 2);
+    memcpy(&indices, block + 4, 4);
+    // RGB565, blue in low bits
+    const bool blue0 = color0 & 0x1f;
+    const bool blue1 = color1 & 0x1f;
+
+    if (!blue0 && !blue1) {
+      continue;
+    }
+
+    // Palette entries with non zero blue, interpolated entries are non
+    // zero when any endpoint is, 3 color mode has black as 4th entry.
+    uint32 usedMask = blue0 | blue1 << 1 | (blue0 || blue1) << 2;
+
+    if (!has3Colors || color0 > color1) {
+      usedMask |= (blue0 || blue1) << 3;
+    }
+
+    for (uint32 t = 0; t < 16; t++, indices >>= 2) {
+      if (usedMask & (1 << (indices & 3))) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Swaps every 16bit word, same as TexelInputFormat::swapPacked does for
+// BC blocks. Endpoints and index rows become little endian.
+inline void SwapPackedBlocks(std::string &data) {
+  for (size_t i = 0; i + 2 <= data.size(); i += 2) {
+    std::swap(data[i], data[i + 1]);
+  }
+}
+
+// BC1-3 2D textures can be stored in DDS without decoding, blocks only
+// need SwapPackedBlocks when decoder would use swapPacked.
+inline bool IsDDSCompatible(const Texture &tex) {
+  using T = TextureFormat;
+
+  if (tex.format != T::BC1 && tex.format != T::BC2 && tex.format != T::BC3) {
+    return false;
+  }
+
+  return !tex.flags.Get<TextureFlags::isCubemap>() &&
+         tex.control3.Get<TextureControl3::depth>() < 2;
+}
+
+// Legacy DXT1/3/5 DDS header of IsDDSCompatible texture,
+// little endian texture payload follows.
+inline std::string DDSHeader(const Texture &tex) {
+  enum : uint32 {
+    DDSD_CAPS = 0x1,
+    DDSD_HEIGHT = 0x2,
+    DDSD_WIDTH = 0x4,
+    DDSD_PIXELFORMAT = 0x1000,
+    DDSD_MIPMAPCOUNT = 0x20000,
+    DDSD_LINEARSIZE = 0x80000,
+    DDPF_FOURCC = 0x4,
+    DDSCAPS_COMPLEX = 0x8,
+    DDSCAPS_TEXTURE = 0x1000,
+    DDSCAPS_MIPMAP = 0x400000,
+  };
+
+  uint32 fourCC = 0;
+  uint32 blockSize = 16;
+
+  switch (tex.format) {
+  case TextureFormat::BC1:
+    fourCC = 0x31545844; // DXT1
+    blockSize = 8;
+    break;
+  case TextureFormat::BC2:
+    fourCC = 0x33545844; // DXT3
+    break;
+  default:
+    fourCC = 0x35545844; // DXT5
+    break;
+  }
+
+  const uint32 width = std::max(uint16(1), tex.width);
+  const uint32 height = std::max(uint16(1), tex.height);
+  const uint32 numMips = std::max(uint16(1), tex.numMips);
+  uint32 header[32]{};
+  header[0] = 0x20534444; // magic
+  header[1] = 124;        // header size
+  header[2] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT |
+              DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+  header[3] = height;
+  header[4] = width;
+  header[5] = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+  header[7] = numMips;
+  header[19] = 32; // pixel format size
+  header[20] = DDPF_FOURCC;
+  header[21] = fourCC;
+  header[27] = DDSCAPS_TEXTURE;
+
+  if (numMips > 1) {
+    header[27] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+  }
+
+  return {reinterpret_cast<const char *>(header), sizeof(header)};
+}
+
+// Keeps converted texture files in memory, so they can be cached, embedded
+// or written to extract context later in fixed order.
+struct TexelMemoryOutput : TexelOutput {
+  struct File {
+    std::string path;
+    std::string data;
+  };
+
+  std::vector<File> files;
+
+  void NewFile(std::string path) override {
+    files.push_back({std::move(path), {}});
+  }
+
+  void SendData(std::string_view data) override {
+    if (files.empty()) {
+      files.emplace_back();
+    }
+
+    files.back().data.append(data);
+  }
+
+  void SendTo(TexelOutput &output) const {
+    for (const File &f : files) {
+      output.NewFile(f.path);
+      output.SendData(f.data);
+    }
+  }
+
+  void Flush(AppExtractContext *ctx) {
+    for (File &f : files) {
+      ctx->NewFile(f.path);
+      ctx->SendData(f.data);
+    }
+
+    files.clear();
+  }
+};
@@ -0,0 +1,145 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/mapped_file.hpp"
+
+#if defined(_WIN32) || defined(__MINGW32__)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+bool MappedFile::Open(const std::string &path, size_t offset, size_t size_,
+                      bool copyOnWrite) {
+  Close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  HANDLE mapping = nullptr;
+
+  if (GetFileSizeEx(file, &fileSize) && size_t(fileSize.QuadPart) > offset) {
+    mapping = CreateFileMappingA(file, nullptr,
+                                 copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+                                 0, 0, nullptr);
+  }
+
+  CloseHandle(file);
+
+  if (!mapping) {
+    return false;
+  }
+
+  if (!size_) {
+    size_ = fileSize.QuadPart - offset;
+  } else if (offset + size_ > size_t(fileSize.QuadPart)) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  const size_t alignedOffset =
+      offset - offset % sysInfo.dwAllocationGranularity;
+  const size_t mapSize = size_ + offset - alignedOffset;
+  base = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ,
+                       DWORD(uint64_t(alignedOffset) >> 32),
+                       DWORD(alignedOffset), mapSize);
+  CloseHandle(mapping);
+
+  if (!base) {
+    return false;
+  }
+
+  baseSize = mapSize;
+  data = static_cast<char *>(base) + offset - alignedOffset;
+  size = size_;
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (base) {
+    UnmapViewOfFile(base);
+  }
+
+  base = nullptr;
+  baseSize = 0;
+  data = nullptr;
+  size = 0;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::Open(const std::string &path, size_t offset, size_t size_,
+                      bool copyOnWrite) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat fileInfo;
+
+  if (fstat(fd, &fileInfo) || size_t(fileInfo.st_size) <= offset ||
+      (size_ && offset + size_ > size_t(fileInfo.st_size))) {
+    close(fd);
+    return false;
+  }
+
+  if (!size_) {
+    size_ = fileInfo.st_size - offset;
+  }
+
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  const size_t alignedOffset = offset - offset % pageSize;
+  const size_t mapSize = size_ + offset - alignedOffset;
+  void *mapped =
+      mmap(nullptr, mapSize, PROT_READ | (copyOnWrite ? PROT_WRITE : 0),
+           MAP_PRIVATE, fd, alignedOffset);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+
+  base = mapped;
+  baseSize = mapSize;
+  data = static_cast<char *>(base) + offset - alignedOffset;
+  size = size_;
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (base) {
+    munmap(base, baseSize);
+  }
+
+  base = nullptr;
+  baseSize = 0;
+  data = nullptr;
+  size = 0;
+}
+#endif
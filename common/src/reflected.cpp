@@ -113,34 +113,11 @@ REFLECT(CLASS(TextureControl3Type),
 
 namespace aggregators {
 void Material(IGHW &main, pugi::xml_node node) {
-  IGHWTOCIteratorConst<Texture> textures;
-  IGHWTOCIteratorConst<MaterialResourceNameLookup> lookups;
-  IGHWTOCIteratorConst<MaterialResourceNameLookupV2> lookupsV2;
-  IGHWTOCIteratorConst<TextureResource> textureResources;
-  IGHWTOCIteratorConst<::Material> materials;
-
-  for (auto &i : main) {
-    switch (i.id) {
-    case Texture::ID:
-      textures = i.Iter<Texture>();
-      break;
-    case MaterialResourceNameLookup::ID:
-      try {
-        lookups = i.Iter<MaterialResourceNameLookup>();
-      } catch (const std::bad_cast &) {
-        lookupsV2 = i.Iter<MaterialResourceNameLookupV2>();
-      }
-      break;
-    case TextureResource::ID:
-      textureResources = i.Iter<TextureResource>();
-      break;
-    case Material::ID:
-      materials = i.Iter<::Material>();
-      break;
-    default:
-      break;
-    }
-  }
+  auto textures = main.TryIter<Texture>();
+  auto lookups = main.TryIter<MaterialResourceNameLookup>();
+  auto lookupsV2 = main.TryIter<MaterialResourceNameLookupV2>();
+  auto textureResources = main.TryIter<TextureResource>();
+  auto materials = main.TryIter<::Material>();
 
   if (materials.Valid()) {
     auto matNode = node.append_child("material");
@@ -16,17 +16,28 @@
 */
 
 #include "insomnia/insomnia.hpp"
+#include "insomnia/internal/parallel.hpp"
+#include "insomnia/internal/swap_tracker.hpp"
+#include "insomnia/internal/swap_words.hpp"
 #include "spike/except.hpp"
 #include "spike/io/binreader_stream.hpp"
-#include <set>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
 
 template <class C>
-void fixupper(CoreClass *data, bool way, std::set<void *> &swapped) {
-  if (swapped.contains(data)) {
+void fixupper(CoreClass *data, bool way, SwapTracker &swapped) {
+  if (!swapped.Mark(data)) {
     return;
   }
 
-  swapped.emplace(data);
   FByteswapper(*static_cast<C *>(data), way);
 }
 
@@ -275,13 +286,11 @@ template <> void FByteswapper(MobyV1 &input, bool) {
 }
 
 template <>
-void fixupper<MobyV1>(CoreClass *data, bool way, std::set<void *> &swapped) {
-  if (swapped.contains(data)) {
+void fixupper<MobyV1>(CoreClass *data, bool way, SwapTracker &swapped) {
+  if (!swapped.Mark(data)) {
     return;
   }
 
-  swapped.emplace(data);
-
   MobyV1 &input = *static_cast<MobyV1 *>(data);
 
   FByteswapper(input, false);
@@ -802,58 +811,116 @@ struct ClassInfo {
   uint32 id;
   uint16 size;
   bool openEnded;
-  void (*swap)(CoreClass *, bool, std::set<void *> &);
+  bool wordArray;
+  void (*swap)(CoreClass *, bool, SwapTracker &);
 };
 
+// Classes made only of 32bit words without pointers.
+// Arrays of these are swapped in bulk with SwapWords kernel.
+template <class C> constexpr bool IS_WORD_ARRAY = false;
+template <uint32 id> constexpr bool IS_WORD_ARRAY<ResourceLookup<id>> = true;
+template <> constexpr bool IS_WORD_ARRAY<TextureResource> = true;
+template <> constexpr bool IS_WORD_ARRAY<ShaderResourceLookup> = true;
+template <> constexpr bool IS_WORD_ARRAY<ZoneHash> = true;
+template <> constexpr bool IS_WORD_ARRAY<ZoneTieLookup> = true;
+template <> constexpr bool IS_WORD_ARRAY<ZoneShaderLookup> = true;
+template <> constexpr bool IS_WORD_ARRAY<ZoneFoliageLookup> = true;
+template <> constexpr bool IS_WORD_ARRAY<ZoneShrubLookup> = true;
+template <> constexpr bool IS_WORD_ARRAY<ShrubV2Instance> = true;
+template <> constexpr bool IS_WORD_ARRAY<FoliageV2Instance> = true;
+template <> constexpr bool IS_WORD_ARRAY<FoliageV2Unk1> = true;
+template <> constexpr bool IS_WORD_ARRAY<UnkInstanceV2> = true;
+template <> constexpr bool IS_WORD_ARRAY<FoliageSpritePositions> = true;
+template <> constexpr bool IS_WORD_ARRAY<NavmeshPositions> = true;
+template <> constexpr bool IS_WORD_ARRAY<NavmeshPositions2> = true;
+
+// Kernel is picked by CPUID on first call, not during static
+// initialization.
+static void SwapWords(char *begin, char *end) {
+  static const SwapWordsFn kernel = SwapWordsKernels().back().fn;
+  kernel(begin, end);
+}
+
 template <class T>
 using is_open_ended = decltype(std::declval<T>().OpenEnded());
 template <class C>
 constexpr static bool is_open_ended_v = es::is_detected_v<is_open_ended, C>;
 
-template <class... C> auto RegisterClasses() {
-  return std::vector<ClassInfo>{
-      {C::ID, sizeof(C), is_open_ended_v<C>, fixupper<C>}...};
+// Sorted by id, classes with same id keep registration order
+template <class... C> constexpr auto RegisterClasses() {
+  static_assert(((!IS_WORD_ARRAY<C> || sizeof(C) % 4 == 0) && ...));
+  std::array<ClassInfo, sizeof...(C)> classes{
+      {{C::ID, sizeof(C), is_open_ended_v<C>, IS_WORD_ARRAY<C>,
+        fixupper<C>}...}};
+
+  for (size_t i = 1; i < classes.size(); i++) {
+    for (size_t j = i; j > 0 && classes[j - 1].id > classes[j].id; j--) {
+      std::swap(classes[j - 1], classes[j]);
+    }
+  }
+
+  return classes;
 }
 
-static const std::vector<ClassInfo> FIXUPS[]{
+static constexpr auto FIXUPS_RFOM =
     RegisterClasses<MobyV1, PrimitiveV1, TieV1, TiePrimitiveV1, TieInstanceV1,
                     RegionMesh, DirectionalLightmapTextureV1, TextureV1,
                     BlendmapTextureV1, MaterialV1, Shrub, Shrubs, Foliage,
                     FoliageSpritePositions, FoliageInstance, NavmeshPositions,
                     NavmeshPositions2, Detail, DetailInstance, DetailCluster,
-                    Gameplay, Sounds, SoundBank>(),
+                    Gameplay, Sounds, SoundBank>();
+
+static constexpr auto FIXUPS_TOD =
     RegisterClasses<MaterialV1_5, Texture, MaterialResourceNameLookup, MobyV1,
                     PrimitiveV2, TiePrimitiveV2, HighmipTextureData,
                     LightmapTexture, ShadowmapTexture, TieV1_5, TieInstanceV1_5,
-                    RegionMeshV2>(),
-    RegisterClasses<
-        ResourceLighting, ResourceZones, ResourceAnimsets, ResourceMobys,
-        ResourceShrubs, ResourceTies, ResourceFoliages, ResourceCubemap,
-        ResourceShaders, ResourceHighmips, ResourceTextures, ResourceCinematics,
-        TextureResource, Material, Texture, MaterialResourceNameLookup,
-        ShaderResourceLookup, ZoneHash, ZoneNameLookup, ZoneLightmap,
-        ZoneShadowMap, ZoneDataLookup, ZoneData2Lookup, ZoneMap, MobyV2,
-        PrimitiveV2, TieV2, TiePrimitiveV2, RegionMeshV2, TieInstanceV2,
-        UnkInstanceV2, ZoneTieLookup, ZoneShaderLookup, ShrubV2,
-        ZoneShrubLookup, ShrubV2Instance, FoliageV2Instance, FoliageV2Unk1,
-        FoliageV2, ZoneFoliageLookup, SoundsV2, SoundBank>(),
-    RegisterClasses<
-        ResourceLighting, ResourceZones, ResourceAnimsets, ResourceMobys,
-        ResourceShrubs, ResourceTies, ResourceFoliages, ResourceCubemap,
-        ResourceShaders, ResourceHighmips, ResourceTextures, ResourceCinematics,
-        TextureResource, Material, Texture, MaterialResourceNameLookupV2,
-        ShaderResourceLookup, ZoneHash, ZoneNameLookup, ZoneLightmap,
-        ZoneShadowMap, ZoneDataLookup, ZoneData2Lookup, ZoneMap, MobyV2,
-        PrimitiveV2, TieV3, TiePrimitiveV3, RegionMeshV2>(),
+                    RegionMeshV2>();
+
+static constexpr auto FIXUPS_V2 = RegisterClasses<
+    ResourceLighting, ResourceZones, ResourceAnimsets, ResourceMobys,
+    ResourceShrubs, ResourceTies, ResourceFoliages, ResourceCubemap,
+    ResourceShaders, ResourceHighmips, ResourceTextures, ResourceCinematics,
+    TextureResource, Material, Texture, MaterialResourceNameLookup,
+    ShaderResourceLookup, ZoneHash, ZoneNameLookup, ZoneLightmap,
+    ZoneShadowMap, ZoneDataLookup, ZoneData2Lookup, ZoneMap, MobyV2,
+    PrimitiveV2, TieV2, TiePrimitiveV2, RegionMeshV2, TieInstanceV2,
+    UnkInstanceV2, ZoneTieLookup, ZoneShaderLookup, ShrubV2,
+    ZoneShrubLookup, ShrubV2Instance, FoliageV2Instance, FoliageV2Unk1,
+    FoliageV2, ZoneFoliageLookup, SoundsV2, SoundBank>();
+
+static constexpr auto FIXUPS_R3 = RegisterClasses<
+    ResourceLighting, ResourceZones, ResourceAnimsets, ResourceMobys,
+    ResourceShrubs, ResourceTies, ResourceFoliages, ResourceCubemap,
+    ResourceShaders, ResourceHighmips, ResourceTextures, ResourceCinematics,
+    TextureResource, Material, Texture, MaterialResourceNameLookupV2,
+    ShaderResourceLookup, ZoneHash, ZoneNameLookup, ZoneLightmap,
+    ZoneShadowMap, ZoneDataLookup, ZoneData2Lookup, ZoneMap, MobyV2,
+    PrimitiveV2, TieV3, TiePrimitiveV3, RegionMeshV2>();
+
+static constexpr std::span<const ClassInfo> FIXUPS[]{
+    FIXUPS_RFOM,
+    FIXUPS_TOD,
+    FIXUPS_V2,
+    FIXUPS_R3,
 };
 
-void IGHW::FromStream(BinReaderRef_e rd, Version version) {
-  rd.SwapEndian(true);
-  IGHWHeader hdr;
-  rd.Push();
-  rd.Read(hdr);
-  rd.Pop();
+static const ClassInfo *FindClass(Version version, const IGHWTOC &item) {
+  auto fixups = FIXUPS[int(version)];
+  auto found = std::lower_bound(
+      fixups.begin(), fixups.end(), item.id,
+      [](const ClassInfo &cls, uint32 id) { return cls.id < id; });
 
+  for (; found != fixups.end() && found->id == item.id; found++) {
+    if (item.count.ArrayType() != IGHWTOCArrayType::Array ||
+        item.size == found->size) {
+      return &*found;
+    }
+  }
+
+  return nullptr;
+}
+
+static void ValidateHeader(const IGHWHeader &hdr) {
   if (hdr.id != hdr.ID) {
     throw es::InvalidHeaderError(hdr.id);
   }
@@ -861,88 +928,573 @@ void IGHW::FromStream(BinReaderRef_e rd, Version version) {
   if (hdr.DEADDEAD == 0xDEADDEAD) {
     throw es::InvalidHeaderError();
   }
+}
+
+void IGHW::FromStream(BinReaderRef_e rd, Version version) {
+  rd.SwapEndian(true);
+  IGHWHeader hdr;
+  rd.Push();
+  rd.Read(hdr);
+  rd.Pop();
+  ValidateHeader(hdr);
 
   if (hdr.versionMajor == 0) {
     hdr.dataEnd = rd.GetSize();
     hdr.numFixups = 0;
-    tocOffset = 0x10;
   }
 
+  mapping.Close();
   rd.ReadContainer(buffer, hdr.dataEnd);
+  base = buffer.data();
+  std::vector<uint32> fixups;
+  rd.ReadContainer(fixups, hdr.numFixups);
+  Setup(hdr, fixups, version);
+}
+
+void IGHW::FromStream(BinReaderRef_e rd, Version version,
+                      std::span<const uint32> classIds) {
+  rd.SwapEndian(true);
+  IGHWHeader hdr;
+  rd.Push();
+  rd.Read(hdr);
+  rd.Pop();
+  ValidateHeader(hdr);
+
+  if (hdr.versionMajor == 0) {
+    FromStream(rd, version);
+    return;
+  }
+
+  const size_t start = rd.Tell();
+  const size_t tocEnd = sizeof(IGHWHeader) + hdr.numToc * sizeof(IGHWTOC);
+
+  if (tocEnd > hdr.dataEnd) {
+    throw es::UnexpectedEOS();
+  }
+
+  mapping.Close();
+  buffer.resize_and_overwrite(hdr.dataEnd,
+                              [](char *, size_t size) { return size; });
+  base = buffer.data();
+  rd.ReadBuffer(base, tocEnd);
+
+  // [data offset, toc index]
+  std::vector<std::pair<uint32, uint32>> tocRanges;
+  std::vector<uint8> requested(hdr.numToc);
+  bool followPointers = false;
+
+  for (uint32 index = 0; index < hdr.numToc; index++) {
+    IGHWTOC item;
+    memcpy(&item, base + sizeof(IGHWHeader) + index * sizeof(IGHWTOC),
+           sizeof(item));
+    FByteswapper(item, false);
+    const uint32 offset = reinterpret_cast<uint32 &>(item.data);
+
+    if (offset < tocEnd || offset >= hdr.dataEnd) {
+      continue;
+    }
+
+    tocRanges.emplace_back(offset, index);
+
+    if (std::find(classIds.begin(), classIds.end(), item.id) !=
+        classIds.end()) {
+      requested[index] = 1;
+      // Unregistered classes are raw data without pointers
+      followPointers |= FindClass(version, item) != nullptr;
+    }
+  }
+
+  std::sort(tocRanges.begin(), tocRanges.end());
+
+  std::vector<uint32> fixups;
+
+  if (followPointers) {
+    rd.Seek(start + hdr.dataEnd);
+    rd.ReadContainer(fixups, hdr.numFixups);
+
+    for (auto &f : fixups) {
+      f &= 0xfffffff;
+    }
+
+    std::sort(fixups.begin(), fixups.end());
+  }
+
+  // Ranges span from entry offset to the next offset, toc entries sharing
+  // offset share range as well.
+  std::vector<uint8> loaded(tocRanges.size());
+  std::vector<std::pair<uint32, uint32>> loadedRanges;
+  std::vector<size_t> queue;
+
+  auto RangeEnd = [&](size_t rangeIndex) {
+    const uint32 offset = tocRanges[rangeIndex].first;
+
+    for (rangeIndex++; rangeIndex < tocRanges.size(); rangeIndex++) {
+      if (tocRanges[rangeIndex].first != offset) {
+        return tocRanges[rangeIndex].first;
+      }
+    }
+
+    return hdr.dataEnd;
+  };
+
+  auto LoadRange = [&](size_t rangeIndex) {
+    const uint32 offset = tocRanges[rangeIndex].first;
+
+    while (rangeIndex > 0 && tocRanges[rangeIndex - 1].first == offset) {
+      rangeIndex--;
+    }
+
+    if (loaded[rangeIndex]) {
+      return;
+    }
+
+    const uint32 rangeEnd = RangeEnd(rangeIndex);
+
+    for (size_t i = rangeIndex;
+         i < tocRanges.size() && tocRanges[i].first == offset; i++) {
+      loaded[i] = 1;
+    }
+
+    rd.Seek(start + offset);
+    rd.ReadBuffer(base + offset, rangeEnd - offset);
+    loadedRanges.emplace_back(offset, rangeEnd);
+    queue.push_back(rangeIndex);
+  };
+
+  for (size_t i = 0; i < tocRanges.size(); i++) {
+    if (requested[tocRanges[i].second]) {
+      LoadRange(i);
+    }
+  }
+
+  while (!queue.empty() && followPointers) {
+    const size_t rangeIndex = queue.back();
+    queue.pop_back();
+    auto fBegin = std::lower_bound(fixups.begin(), fixups.end(),
+                                   tocRanges[rangeIndex].first);
+    auto fEnd =
+        std::lower_bound(fBegin, fixups.end(), RangeEnd(rangeIndex));
+
+    for (; fBegin != fEnd; fBegin++) {
+      uint32 target;
+      memcpy(&target, base + *fBegin, sizeof(target));
+      FByteswapper(target);
+      auto found = std::upper_bound(tocRanges.begin(), tocRanges.end(),
+                                    std::make_pair(target, uint32(-1)));
+
+      if (target && found != tocRanges.begin()) {
+        LoadRange(std::distance(tocRanges.begin(), found) - 1);
+      }
+    }
+  }
+
+  std::sort(loadedRanges.begin(), loadedRanges.end());
+  std::erase_if(fixups, [&](uint32 f) {
+    auto found = std::upper_bound(loadedRanges.begin(), loadedRanges.end(),
+                                  std::make_pair(f, uint32(-1)));
+    return found == loadedRanges.begin() || std::prev(found)->second <= f;
+  });
+
+  Setup(hdr, fixups, version);
+
+  for (size_t i = 0; i < tocRanges.size(); i++) {
+    if (!loaded[i]) {
+      // Never swap data that was not read
+      fixedToc[tocRanges[i].second] = 1;
+    }
+  }
+
+  std::erase_if(tocIndex, [&](auto &item) {
+    return fixedToc[item.second] != 0;
+  });
+}
+
+bool IGHW::FromFile(const std::string &path, size_t offset, size_t size,
+                    Version version) {
+  MappedFile newMapping;
+
+  if (!newMapping.Open(path, offset, size, true) ||
+      newMapping.Size() < sizeof(IGHWHeader)) {
+    return false;
+  }
+
+  IGHWHeader hdr;
+  memcpy(&hdr, newMapping.Data(), sizeof(hdr));
+  FByteswapper(hdr);
+  ValidateHeader(hdr);
 
+  if (hdr.versionMajor == 0) {
+    hdr.dataEnd = newMapping.Size();
+    hdr.numFixups = 0;
+  } else if (size_t(hdr.dataEnd) + hdr.numFixups * sizeof(uint32) >
+             newMapping.Size()) {
+    throw es::UnexpectedEOS();
+  }
+
+  std::vector<uint32> fixups(hdr.numFixups);
+
+  // Empty vector has no storage to copy into
+  if (hdr.numFixups) {
+    memcpy(fixups.data(), newMapping.Data() + hdr.dataEnd,
+           hdr.numFixups * sizeof(uint32));
+  }
+
+  for (auto &f : fixups) {
+    FByteswapper(f);
+  }
+
+  buffer = {};
+  mapping = std::move(newMapping);
+  base = mapping.Data();
+  Setup(hdr, fixups, version);
+
+  return true;
+}
+
+void IGHW::FromMemory(std::string_view data, Version version) {
+  if (data.size() < sizeof(IGHWHeader)) {
+    throw es::UnexpectedEOS();
+  }
+
+  IGHWHeader hdr;
+  memcpy(&hdr, data.data(), sizeof(hdr));
+  FByteswapper(hdr);
+  ValidateHeader(hdr);
+
+  if (hdr.versionMajor == 0) {
+    hdr.dataEnd = data.size();
+    hdr.numFixups = 0;
+  } else if (size_t(hdr.dataEnd) + hdr.numFixups * sizeof(uint32) >
+             data.size()) {
+    throw es::UnexpectedEOS();
+  }
+
+  std::vector<uint32> fixups(hdr.numFixups);
+
+  if (hdr.numFixups) {
+    memcpy(fixups.data(), data.data() + hdr.dataEnd,
+           hdr.numFixups * sizeof(uint32));
+  }
+
+  for (auto &f : fixups) {
+    FByteswapper(f);
+  }
+
+  mapping.Close();
+  buffer.assign(data.data(), hdr.dataEnd);
+  base = buffer.data();
+  Setup(hdr, fixups, version);
+}
+
+struct IGHWCacheHeader {
+  static constexpr uint32 ID = CompileFourCC("IGHC");
+  static constexpr uint32 VERSION = 1;
+  static constexpr uint32 ENDIAN_MARK = 0x01020304;
+  uint32 id = ID;
+  uint32 formatVersion = VERSION;
+  uint32 byteOrder = ENDIAN_MARK;
+  uint32 ighwVersion;
+  uint64 sourceOffset;
+  uint64 sourceSize;
+  int64 sourceTime;
+  uint32 pathSize;
+  uint32 tocOffset;
+  uint32 dataOffset;
+  uint32 dataEnd;
+};
+
+bool IGHW::FromCache(const std::string &cacheDir, const std::string &path,
+                     size_t offset, size_t size, Version version_) {
+  return LoadCached(cacheDir, path, offset, size, version_, {});
+}
+
+bool IGHW::FromCache(const std::string &cacheDir, const std::string &path,
+                     size_t offset, std::string_view data, Version version_) {
+  return LoadCached(cacheDir, path, offset, data.size(), version_, data);
+}
+
+bool IGHW::LoadCached(const std::string &cacheDir, const std::string &path,
+                      size_t offset, size_t size, Version version_,
+                      std::string_view data) {
+  auto Load = [&] {
+    if (!data.data()) {
+      return FromFile(path, offset, size, version_);
+    }
+
+    FromMemory(data, version_);
+    return true;
+  };
+
+  if (cacheDir.empty()) {
+    return Load();
+  }
+
+  std::error_code ec;
+  const auto sourceTime = std::filesystem::last_write_time(path, ec);
+
+  if (ec) {
+    return Load();
+  }
+
+  IGHWCacheHeader key;
+  key.ighwVersion = uint32(version_);
+  key.sourceOffset = offset;
+  key.sourceSize = size;
+  key.sourceTime = sourceTime.time_since_epoch().count();
+  key.pathSize = path.size();
+
+  char cacheName[0x40];
+  snprintf(cacheName, sizeof(cacheName), "%.16" PRIX64 ".%.8" PRIX64 ".ighwc",
+           uint64(std::hash<std::string>{}(path)), uint64(offset));
+  const std::string cachePath =
+      (std::filesystem::path(cacheDir) / cacheName).string();
+
+  if (MappedFile cached; cached.Open(cachePath, 0, 0, true) &&
+                         cached.Size() >= sizeof(IGHWCacheHeader)) {
+    IGHWCacheHeader hdr;
+    memcpy(&hdr, cached.Data(), sizeof(hdr));
+
+    if (hdr.id == key.id && hdr.formatVersion == key.formatVersion &&
+        hdr.byteOrder == key.byteOrder && hdr.ighwVersion == key.ighwVersion &&
+        hdr.sourceOffset == key.sourceOffset &&
+        hdr.sourceSize == key.sourceSize &&
+        hdr.sourceTime == key.sourceTime && hdr.pathSize == key.pathSize &&
+        size_t(hdr.dataOffset) + hdr.dataEnd == cached.Size() &&
+        std::string_view(cached.Data() + sizeof(hdr),
+                         std::min<size_t>(hdr.pathSize,
+                                          cached.Size() - sizeof(hdr))) ==
+            path) {
+      // Pointers are self relative, mapped data is usable as is
+      buffer = {};
+      mapping = std::move(cached);
+      base = mapping.Data() + hdr.dataOffset;
+      tocOffset = hdr.tocOffset;
+      version = version_;
+      dataEnd = hdr.dataEnd;
+      BuildTocIndex();
+      fixedToc.assign(Header()->numToc, 1);
+      tocDeps.clear();
+      swapped.clear();
+
+      return true;
+    }
+  }
+
+  if (!Load()) {
+    return false;
+  }
+
+  FixupAll();
+
+  key.tocOffset = tocOffset;
+  key.dataOffset = (sizeof(key) + key.pathSize + 15) & ~15;
+  key.dataEnd = size ? std::min<size_t>(size, dataEnd) : dataEnd;
+
+  // Write into temporary file first, so concurrent runs never map
+  // partially written cache.
+  const std::string tempPath =
+      cachePath + "." + std::to_string(std::random_device{}());
+
+  {
+    std::filesystem::create_directories(cacheDir, ec);
+    std::ofstream str(tempPath, std::ios::binary);
+    const char padding[16]{};
+    str.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    str.write(path.data(), path.size());
+    str.write(padding, key.dataOffset - sizeof(key) - key.pathSize);
+    str.write(base, key.dataEnd);
+
+    if (!str) {
+      str.close();
+      std::filesystem::remove(tempPath, ec);
+      return true;
+    }
+  }
+
+  std::filesystem::rename(tempPath, cachePath, ec);
+
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+  }
+
+  return true;
+}
+
+void IGHW::Setup(const IGHWHeader &hdr, std::span<const uint32> fixups,
+                 Version version_) {
+  tocOffset = hdr.versionMajor == 0 ? 0x10 : sizeof(IGHWHeader);
+  version = version_;
   FByteswapper(*Header());
 
   for (auto &item : *this) {
     FByteswapper(item, false);
-    item.data.Fixup(buffer.data());
+    item.data.Fixup(base);
 
     if (hdr.versionMajor == 0 && item.id != -1U) {
       item.size = item.count.Count();
     }
   }
 
+  // [data offset, toc index]
+  std::vector<std::pair<uint32, uint32>> tocRanges;
+
+  for (uint32 index = 0; auto &item : *this) {
+    if (item.data.Get()) {
+      tocRanges.emplace_back(reinterpret_cast<char *>(item.data.Get()) - base,
+                             index);
+    }
+
+    index++;
+  }
+
+  std::sort(tocRanges.begin(), tocRanges.end());
+  BuildTocIndex();
+
+  auto FindToc = [&](uint32 offset) -> uint32 {
+    auto found = std::upper_bound(tocRanges.begin(), tocRanges.end(),
+                                  std::make_pair(offset, uint32(-1)));
+
+    if (found == tocRanges.begin()) {
+      return -1;
+    }
+
+    return std::prev(found)->second;
+  };
+
+  tocDeps.clear();
+  std::mutex depsMutex;
+  using TocDeps = decltype(tocDeps);
+
+  auto FixupPointer = [&](uint32 f, TocDeps &deps) {
+    f &= 0xfffffff;
+    auto ptr = reinterpret_cast<es::PointerX86<char> *>(base + f);
+    FByteswapper(*ptr);
+    ptr->Fixup(base);
+
+    if (!ptr->Get()) {
+      return;
+    }
+
+    const uint32 from = FindToc(f);
+    const uint32 to = FindToc(ptr->Get() - base);
+
+    if (from != to && from != -1U && to != -1U) {
+      deps.emplace_back(from, to);
+    }
+  };
+
+  auto MergeDeps = [&](const TocDeps &deps) {
+    std::lock_guard<std::mutex> lock(depsMutex);
+    tocDeps.insert(tocDeps.end(), deps.begin(), deps.end());
+  };
+
   if (hdr.versionMajor == 0) {
     auto *lastItem = std::prev(end());
     uint32 *fixupsBegin = reinterpret_cast<uint32 *>(
         reinterpret_cast<char *>(lastItem->data.Get()) +
         lastItem->count.Count());
-    uint32 *fixupsEnd = reinterpret_cast<uint32 *>(buffer.data() + hdr.dataEnd);
-    for (uint32 *f = fixupsBegin; f < fixupsEnd; f++) {
-      FByteswapper(*f);
-
-      *f &= 0xfffffff;
-      auto ptr = reinterpret_cast<es::PointerX86<uint32> *>(&buffer[0] + *f);
-      FByteswapper(*ptr);
-      ptr->Fixup(buffer.data());
+    uint32 *fixupsEnd = reinterpret_cast<uint32 *>(base + hdr.dataEnd);
+
+    ParallelFor(std::distance(fixupsBegin, fixupsEnd), numThreads,
+                [&](size_t first, size_t last) {
+                  TocDeps deps;
+
+                  for (size_t i = first; i < last; i++) {
+                    FByteswapper(fixupsBegin[i]);
+                    FixupPointer(fixupsBegin[i], deps);
+                  }
+
+                  MergeDeps(deps);
+                });
+  } else {
+    ParallelFor(fixups.size(), numThreads, [&](size_t first, size_t last) {
+      TocDeps deps;
+
+      for (size_t i = first; i < last; i++) {
+        FixupPointer(fixups[i], deps);
+      }
+
+      MergeDeps(deps);
+    });
+  }
+
+  std::sort(tocDeps.begin(), tocDeps.end());
+  tocDeps.erase(std::unique(tocDeps.begin(), tocDeps.end()), tocDeps.end());
+  fixedToc.assign(hdr.numToc, 0);
+  dataEnd = hdr.dataEnd;
+  swapped.clear();
+}
+
+void IGHW::BuildTocIndex() {
+  tocIndex.clear();
+
+  for (uint32 index = 0; auto &item : *this) {
+    tocIndex.emplace_back(item.id, index++);
+  }
+
+  std::sort(tocIndex.begin(), tocIndex.end());
+}
+
+void IGHW::Fixup(const IGHWTOC &toc) {
+  FixupToc(std::distance(std::as_const(*this).begin(), &toc), false);
+}
+
+void IGHW::FixupAll() {
+  if (swapped.empty()) {
+    swapped.resize((dataEnd / 4 + 63) / 64);
+  }
+
+  ParallelFor(fixedToc.size(), numThreads, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      FixupToc(i, numThreads != 1);
     }
-  } else if (hdr.numFixups) {
-    std::vector<uint32> fixups;
-    rd.ReadContainer(fixups, hdr.numFixups);
+  });
+}
 
-    for (auto f : fixups) {
-      f &= 0xfffffff;
-      auto ptr = reinterpret_cast<es::PointerX86<uint32> *>(&buffer[0] + f);
-      FByteswapper(*ptr);
-      ptr->Fixup(buffer.data());
+void IGHW::FixupToc(uint32 index, bool concurrent) {
+  uint8 &fixed = fixedToc.at(index);
+
+  if (concurrent) {
+    if (std::atomic_ref<uint8>(fixed).exchange(1)) {
+      return;
     }
+  } else if (fixed) {
+    return;
+  } else {
+    fixed = 1;
   }
 
-  std::set<void *> swapped;
+  IGHWTOC &item = begin()[index];
+  const ClassInfo *found = FindClass(version, item);
 
-  for (auto &item : *this) {
-    auto &fixups = FIXUPS[int(version)];
-    auto found =
-        std::find_if(fixups.begin(), fixups.end(), [&](const ClassInfo &cls) {
-          if (cls.id != item.id) {
-            return false;
-          }
-
-          if (item.count.ArrayType() == IGHWTOCArrayType::Array) {
-            return item.size == cls.size;
-          }
-
-          return true;
-        });
-
-    if (!es::IsEnd(fixups, found)) {
-      char *start = reinterpret_cast<char *>(item.data.operator->());
-      char *end = nullptr;
-
-      switch (item.count.ArrayType()) {
-      case IGHWTOCArrayType::Buffer:
-        end = reinterpret_cast<char *>(start) + item.size;
-        break;
-      case IGHWTOCArrayType::Array:
-        end =
-            reinterpret_cast<char *>(start) + item.count.Count() * found->size;
-        break;
-
-      default:
-        throw std::runtime_error("Unknown array type");
-      }
+  if (found) {
+    if (swapped.empty()) {
+      swapped.resize((dataEnd / 4 + 63) / 64);
+    }
+
+    SwapTracker tracker{base, swapped, concurrent};
+    char *start = reinterpret_cast<char *>(item.data.operator->());
+    char *end = nullptr;
+
+    switch (item.count.ArrayType()) {
+    case IGHWTOCArrayType::Buffer:
+      end = reinterpret_cast<char *>(start) + item.size;
+      break;
+    case IGHWTOCArrayType::Array:
+      end = reinterpret_cast<char *>(start) + item.count.Count() * found->size;
+      break;
 
+    default:
+      throw std::runtime_error("Unknown array type");
+    }
+
+    if (found->wordArray) {
+      if (tracker.Mark(start)) {
+        SwapWords(start, end);
+      }
+    } else {
       while (start < end) {
-        found->swap(reinterpret_cast<CoreClass *>(start), false, swapped);
+        found->swap(reinterpret_cast<CoreClass *>(start), false, tracker);
         start += found->size;
 
         if (found->openEnded) {
@@ -951,4 +1503,149 @@ void IGHW::FromStream(BinReaderRef_e rd, Version version) {
       }
     }
   }
+
+  auto deps = std::equal_range(
+      tocDeps.begin(), tocDeps.end(), std::make_pair(index, uint32(0)),
+      [](auto &a, auto &b) { return a.first < b.first; });
+
+  for (auto it = deps.first; it != deps.second; it++) {
+    FixupToc(it->second, concurrent);
+  }
+}
+
+void IGHWWindowReader::FromStream(std::istream &stream_) {
+  stream = &stream_;
+  memory = nullptr;
+  origin = stream->tellg();
+  IGHWHeader hdr;
+  stream->read(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+
+  if (!*stream) {
+    throw es::UnexpectedEOS();
+  }
+
+  FByteswapper(hdr);
+  ValidateHeader(hdr);
+
+  if (hdr.versionMajor == 0) {
+    stream->seekg(0, std::ios::end);
+    dataEnd = size_t(stream->tellg()) - origin;
+  } else {
+    dataEnd = hdr.dataEnd;
+  }
+
+  std::vector<IGHWTOC> toc(hdr.numToc);
+  stream->seekg(origin + (hdr.versionMajor == 0 ? 0x10 : sizeof(IGHWHeader)));
+  stream->read(reinterpret_cast<char *>(toc.data()),
+               toc.size() * sizeof(IGHWTOC));
+
+  if (!*stream) {
+    throw es::UnexpectedEOS();
+  }
+
+  BuildEntries(hdr, toc);
+}
+
+void IGHWWindowReader::FromMemory(std::string_view data) {
+  if (data.size() < sizeof(IGHWHeader)) {
+    throw es::UnexpectedEOS();
+  }
+
+  IGHWHeader hdr;
+  memcpy(&hdr, data.data(), sizeof(hdr));
+  FByteswapper(hdr);
+  ValidateHeader(hdr);
+
+  const size_t tocOffset = hdr.versionMajor == 0 ? 0x10 : sizeof(IGHWHeader);
+  dataEnd = hdr.versionMajor == 0 ? data.size() : hdr.dataEnd;
+
+  if (tocOffset + hdr.numToc * sizeof(IGHWTOC) > data.size() ||
+      dataEnd > data.size()) {
+    throw es::UnexpectedEOS();
+  }
+
+  std::vector<IGHWTOC> toc(hdr.numToc);
+  memcpy(toc.data(), data.data() + tocOffset, toc.size() * sizeof(IGHWTOC));
+  stream = nullptr;
+  memory = data.data();
+  origin = 0;
+  BuildEntries(hdr, toc);
+}
+
+void IGHWWindowReader::BuildEntries(const IGHWHeader &hdr,
+                                    std::vector<IGHWTOC> &toc) {
+  entries.clear();
+  windows.clear();
+  cachedSize = 0;
+
+  for (auto &item : toc) {
+    FByteswapper(item, false);
+    Entry &entry = entries.emplace_back();
+    entry.id = item.id;
+    entry.offset = reinterpret_cast<uint32 &>(item.data);
+
+    if (hdr.versionMajor == 0) {
+      entry.size = item.count.Count();
+    } else if (item.count.ArrayType() == IGHWTOCArrayType::Array) {
+      entry.size = item.count.Count() * item.size;
+    } else {
+      entry.size = item.size;
+    }
+  }
+
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b) { return a.id < b.id; });
+}
+
+std::shared_ptr<const char>
+IGHWWindowReader::Window(const Entry &entry, size_t offset, size_t size) {
+  if (offset > entry.size || size > entry.size - offset) {
+    throw std::out_of_range("Window outside of TOC entry");
+  }
+
+  const size_t begin = entry.offset + offset;
+  const size_t end = begin + size;
+  const size_t entryEnd = size_t(entry.offset) + entry.size;
+
+  if (entryEnd > dataEnd) {
+    throw es::UnexpectedEOS();
+  }
+
+  if (memory) {
+    return {std::shared_ptr<const char>{}, memory + begin};
+  }
+
+  for (auto it = windows.begin(); it != windows.end(); it++) {
+    if (it->begin <= begin && end <= it->end) {
+      windows.splice(windows.begin(), windows, it);
+      return {it->data, it->data->data() + (begin - it->begin)};
+    }
+  }
+
+  // Aligned, but never reads past entry range
+  Block block;
+  block.begin = std::max(begin - begin % windowSize, size_t(entry.offset));
+  const size_t roundedEnd = end + windowSize - 1;
+  block.end = std::min(roundedEnd - roundedEnd % windowSize, entryEnd);
+  block.data = std::make_shared<std::string>();
+  block.data->resize_and_overwrite(block.end - block.begin,
+                                   [](char *, size_t size) { return size; });
+  stream->clear();
+  stream->seekg(origin + block.begin);
+  stream->read(block.data->data(), block.data->size());
+
+  if (!*stream) {
+    throw es::UnexpectedEOS();
+  }
+
+  cachedSize += block.data->size();
+  windows.push_front(block);
+
+  while (cachedSize > memoryLimit && windows.size() > 1) {
+    cachedSize -= windows.back().data->size();
+    windows.pop_back();
+  }
+
+  return {block.data, block.data->data() + (begin - block.begin)};
 }
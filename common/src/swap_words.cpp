@@ -0,0 +1,92 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/swap_words.hpp"
+#include "spike/util/endian.hpp"
+#include <array>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SWAP_WORDS_X86
+#include <immintrin.h>
+#endif
+
+static void SwapWordsScalar(char *begin, char *end) {
+  for (; begin + 4 <= end; begin += 4) {
+    uint32 word;
+    memcpy(&word, begin, 4);
+    FByteswapper(word);
+    memcpy(begin, &word, 4);
+  }
+}
+
+#ifdef SWAP_WORDS_X86
+// Kernels are compiled for their instruction set only and
+// selected by CPUID, so they are never called on older CPUs.
+__attribute__((target("ssse3"))) static void SwapWordsSSSE3(char *begin,
+                                                            char *end) {
+  const __m128i mask =
+      _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+  for (; begin + 16 <= end; begin += 16) {
+    __m128i *item = reinterpret_cast<__m128i *>(begin);
+    _mm_storeu_si128(item, _mm_shuffle_epi8(_mm_loadu_si128(item), mask));
+  }
+
+  SwapWordsScalar(begin, end);
+}
+
+__attribute__((target("avx2"))) static void SwapWordsAVX2(char *begin,
+                                                          char *end) {
+  const __m256i mask = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+      5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+  for (; begin + 32 <= end; begin += 32) {
+    __m256i *item = reinterpret_cast<__m256i *>(begin);
+    _mm256_storeu_si256(item,
+                        _mm256_shuffle_epi8(_mm256_loadu_si256(item), mask));
+  }
+
+  SwapWordsSSSE3(begin, end);
+}
+#endif
+
+std::span<const SwapWordsKernel> SwapWordsKernels() {
+  static const auto kernels = [] {
+    std::array<SwapWordsKernel, 3> retVal{};
+    size_t numKernels = 0;
+    retVal[numKernels++] = {"scalar", SwapWordsScalar};
+
+#ifdef SWAP_WORDS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("ssse3")) {
+      retVal[numKernels++] = {"ssse3", SwapWordsSSSE3};
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+      retVal[numKernels++] = {"avx2", SwapWordsAVX2};
+    }
+#endif
+
+    return std::make_pair(retVal, numKernels);
+  }();
+
+  return {kernels.first.data(), kernels.second};
+}
@@ -0,0 +1,123 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "insomnia/insomnia.hpp"
+#include <cstddef>
+#include <string>
+
+// Big endian IGHW v1 with single array TOC entry of numItems classes C,
+// every 32bit word of item i holds i + valueBase. No pointers.
+template <class C>
+std::string MakeSyntheticIGHW(uint32 numItems, uint32 valueBase = 0) {
+  static_assert(sizeof(C) % 4 == 0);
+  static constexpr uint32 DATA_OFFSET = sizeof(IGHWHeader) + sizeof(IGHWTOC);
+  const uint32 dataEnd = DATA_OFFSET + numItems * sizeof(C);
+  std::string retVal;
+  retVal.reserve(dataEnd);
+
+  auto Write = [&](uint32 value) {
+    const char bytes[]{char(value >> 24), char(value >> 16), char(value >> 8),
+                       char(value)};
+    retVal.append(bytes, sizeof(bytes));
+  };
+
+  retVal.append("IGHW");
+  Write(0x00010001); // version major, minor
+  Write(1);          // numToc
+  Write(DATA_OFFSET);
+  Write(dataEnd);
+  Write(0); // numFixups
+  retVal.append(8, 0);
+
+  Write(C::ID);
+  Write(DATA_OFFSET);
+  Write(numItems << 4 | uint32(IGHWTOCArrayType::Array));
+  Write(sizeof(C));
+
+  for (uint32 i = 0; i < numItems; i++) {
+    for (size_t w = 0; w < sizeof(C) / 4; w++) {
+      Write(i + valueBase);
+    }
+  }
+
+  return retVal;
+}
+
+// Big endian IGHW v1 with three TOC entries:
+// single MaterialResourceNameLookup, its lookupPath points to first
+// Texture of numItems Textures, followed by numItems unrelated
+// TextureResources. First word of every Texture and every word of
+// TextureResource i holds i.
+inline std::string MakeLinkedIGHW(uint32 numItems) {
+  static constexpr uint32 NUM_TOC = 3;
+  static constexpr uint32 DATA_OFFSET =
+      sizeof(IGHWHeader) + sizeof(IGHWTOC) * NUM_TOC;
+  static constexpr uint32 LOOKUP_SIZE = sizeof(MaterialResourceNameLookup);
+  static constexpr uint32 POINTER_OFFSET =
+      DATA_OFFSET + offsetof(MaterialResourceNameLookup, lookupPath);
+  const uint32 texturesOffset = DATA_OFFSET + LOOKUP_SIZE;
+  const uint32 resourcesOffset = texturesOffset + numItems * sizeof(Texture);
+  const uint32 dataEnd = resourcesOffset + numItems * sizeof(TextureResource);
+  std::string retVal;
+  retVal.reserve(dataEnd + sizeof(uint32));
+
+  auto Write = [&](uint32 value) {
+    const char bytes[]{char(value >> 24), char(value >> 16), char(value >> 8),
+                       char(value)};
+    retVal.append(bytes, sizeof(bytes));
+  };
+
+  auto WriteToc = [&](uint32 id, uint32 offset, uint32 count, uint32 size) {
+    Write(id);
+    Write(offset);
+    Write(count << 4 | uint32(IGHWTOCArrayType::Array));
+    Write(size);
+  };
+
+  retVal.append("IGHW");
+  Write(0x00010001); // version major, minor
+  Write(NUM_TOC);
+  Write(DATA_OFFSET);
+  Write(dataEnd);
+  Write(1); // numFixups
+  retVal.append(8, 0);
+
+  WriteToc(MaterialResourceNameLookup::ID, DATA_OFFSET, 1, LOOKUP_SIZE);
+  WriteToc(Texture::ID, texturesOffset, numItems, sizeof(Texture));
+  WriteToc(TextureResource::ID, resourcesOffset, numItems,
+           sizeof(TextureResource));
+
+  Write(0x1234); // hash.part1
+  Write(0x5678); // hash.part2
+  Write(texturesOffset);
+  retVal.append(LOOKUP_SIZE - 12, 0);
+
+  for (uint32 i = 0; i < numItems; i++) {
+    Write(i);
+    retVal.append(sizeof(Texture) - 4, 0);
+  }
+
+  for (uint32 i = 0; i < numItems; i++) {
+    for (size_t w = 0; w < sizeof(TextureResource) / 4; w++) {
+      Write(i);
+    }
+  }
+
+  Write(POINTER_OFFSET);
+  return retVal;
+}
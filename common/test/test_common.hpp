@@ -0,0 +1,61 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+
+// Returns 1 from calling test function when expression is false
+#define TEST_CHECK(...)                                                        \
+  if (!(__VA_ARGS__)) {                                                        \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+            #__VA_ARGS__);                                                     \
+    return 1;                                                                  \
+  }
+
+template <class E, class Fn> bool Throws(Fn &&fn) {
+  try {
+    fn();
+  } catch (const E &) {
+    return true;
+  } catch (...) {
+  }
+
+  return false;
+}
+
+// Empty folder in system temp, removed with all contents on destruction
+struct TempDir {
+  std::filesystem::path path;
+
+  TempDir() {
+    path = std::filesystem::temp_directory_path() /
+           ("insomnia_test_" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(path);
+  }
+
+  ~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+  }
+
+  std::string operator/(const std::string &name) const {
+    return (path / name).string();
+  }
+};
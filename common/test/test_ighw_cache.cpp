@@ -0,0 +1,189 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/insomnia.hpp"
+#include "synthetic_ighw.hpp"
+#include "test_common.hpp"
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+static constexpr uint32 NUM_ITEMS = 1000;
+
+static void WriteFile(const std::string &path, const std::string &data) {
+  std::ofstream str(path, std::ios::binary | std::ios::trunc);
+  str.write(data.data(), data.size());
+}
+
+static size_t NumFiles(const std::string &dir) {
+  size_t numFiles = 0;
+
+  for (auto &entry : std::filesystem::directory_iterator(dir)) {
+    numFiles += entry.is_regular_file();
+  }
+
+  return numFiles;
+}
+
+static bool HasValues(IGHW &main, uint32 valueBase) {
+  auto items = main.TryIter<TextureResource>();
+
+  if (std::distance(items.begin(), items.end()) != NUM_ITEMS) {
+    return false;
+  }
+
+  for (uint32 i = 0; i < NUM_ITEMS; i++) {
+    const TextureResource &item = items.at(i);
+
+    if (item.hash != i + valueBase || item.totalSize != i + valueBase) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static int TestFromCache() {
+  using namespace std::chrono_literals;
+  TempDir dir;
+  const std::string source = dir / "source.dat";
+  const std::string cacheDir = dir / "cache";
+  // IGHW is stored at offset, same as zones and shaders
+  const std::string prefix(100, 'p');
+  const std::string ighw = MakeSyntheticIGHW<TextureResource>(NUM_ITEMS);
+  WriteFile(source, prefix + ighw + "trailing data");
+
+  IGHW main;
+  TEST_CHECK(main.FromCache(cacheDir, source, prefix.size(), ighw.size(),
+                            Version::V2));
+  TEST_CHECK(HasValues(main, 0));
+  TEST_CHECK(NumFiles(cacheDir) == 1);
+
+  // Source changed but modification time did not, cached copy is used
+  const auto sourceTime = std::filesystem::last_write_time(source);
+  WriteFile(source,
+            prefix + MakeSyntheticIGHW<TextureResource>(NUM_ITEMS, 5000));
+  std::filesystem::last_write_time(source, sourceTime);
+
+  IGHW cached;
+  TEST_CHECK(cached.FromCache(cacheDir, source, prefix.size(), ighw.size(),
+                              Version::V2));
+  TEST_CHECK(HasValues(cached, 0));
+
+  // Modification time is part of the key
+  std::filesystem::last_write_time(source, sourceTime + 1s);
+
+  IGHW updated;
+  TEST_CHECK(updated.FromCache(cacheDir, source, prefix.size(), ighw.size(),
+                               Version::V2));
+  TEST_CHECK(HasValues(updated, 5000));
+  TEST_CHECK(NumFiles(cacheDir) == 1);
+
+  // So is size
+  const auto updatedTime = std::filesystem::last_write_time(source);
+  WriteFile(source,
+            prefix + MakeSyntheticIGHW<TextureResource>(NUM_ITEMS, 9000));
+  std::filesystem::last_write_time(source, updatedTime);
+
+  IGHW resized;
+  TEST_CHECK(resized.FromCache(cacheDir, source, prefix.size(), 0,
+                               Version::V2));
+  TEST_CHECK(HasValues(resized, 9000));
+
+  // Empty cacheDir loads source directly
+  IGHW direct;
+  TEST_CHECK(
+      direct.FromCache("", source, prefix.size(), ighw.size(), Version::V2));
+  TEST_CHECK(HasValues(direct, 9000));
+
+  return 0;
+}
+
+static int TestFromCacheMemory() {
+  TempDir dir;
+  const std::string source = dir / "source.dat";
+  const std::string cacheDir = dir / "cache";
+  const std::string prefix(100, 'p');
+  const std::string ighw = MakeSyntheticIGHW<TextureResource>(NUM_ITEMS);
+  WriteFile(source, prefix + ighw);
+
+  // Data differs from source, shows which one was parsed
+  const std::string data = MakeSyntheticIGHW<TextureResource>(NUM_ITEMS, 3);
+
+  IGHW direct;
+  TEST_CHECK(direct.FromCache("", source, prefix.size(), data, Version::V2));
+  TEST_CHECK(HasValues(direct, 3));
+  TEST_CHECK(!std::filesystem::exists(cacheDir));
+
+  IGHW main;
+  TEST_CHECK(main.FromCache(cacheDir, source, prefix.size(), data,
+                            Version::V2));
+  TEST_CHECK(HasValues(main, 3));
+  TEST_CHECK(NumFiles(cacheDir) == 1);
+
+  // Shares key with size variant
+  IGHW cached;
+  TEST_CHECK(cached.FromCache(cacheDir, source, prefix.size(), ighw.size(),
+                              Version::V2));
+  TEST_CHECK(HasValues(cached, 3));
+
+  return 0;
+}
+
+static int TestFromFile() {
+  TempDir dir;
+  const std::string source = dir / "source.dat";
+  const std::string ighw = MakeSyntheticIGHW<TextureResource>(NUM_ITEMS, 7);
+  WriteFile(source, ighw);
+
+  IGHW main;
+  TEST_CHECK(main.FromFile(source, 0, ighw.size(), Version::V2));
+  TEST_CHECK(HasValues(main, 7));
+
+  // Range past end of file
+  TEST_CHECK(!main.FromFile(source, 0, ighw.size() + 1, Version::V2));
+  TEST_CHECK(!main.FromFile(dir / "missing.dat", 0, 0, Version::V2));
+
+  return 0;
+}
+
+static int TestWindowBounds() {
+  const std::string ighw = MakeSyntheticIGHW<TextureResource>(NUM_ITEMS);
+  const size_t entrySize = NUM_ITEMS * sizeof(TextureResource);
+  IGHWWindowReader reader;
+  reader.FromMemory(ighw);
+  const IGHWWindowReader::Entry *entry = reader.Find(TextureResource::ID);
+  TEST_CHECK(entry);
+  TEST_CHECK(entry->size == entrySize);
+  TEST_CHECK(reader.Window(*entry, entrySize - 4, 4));
+  TEST_CHECK(reader.Window(*entry, entrySize, 0));
+
+  auto Window = [&](size_t offset, size_t size) {
+    return [&, offset, size] { reader.Window(*entry, offset, size); };
+  };
+
+  TEST_CHECK(Throws<std::out_of_range>(Window(entrySize - 4, 5)));
+  TEST_CHECK(Throws<std::out_of_range>(Window(entrySize + 1, 0)));
+  TEST_CHECK(Throws<std::out_of_range>(Window(4, size_t(-1))));
+
+  return 0;
+}
+
+int main() {
+  return TestFromCache() || TestFromCacheMemory() || TestFromFile() ||
+         TestWindowBounds();
+}
@@ -0,0 +1,102 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/insomnia.hpp"
+#include "synthetic_ighw.hpp"
+#include "test_common.hpp"
+#include <bit>
+
+static constexpr uint32 NUM_ITEMS = 100;
+
+static std::string_view TocData(const IGHWTOC &toc) {
+  return {reinterpret_cast<const char *>(toc.data.Get()),
+          toc.count.Count() * toc.size};
+}
+
+static int TestLazyFixup() {
+  IGHW main;
+  main.FromMemory(MakeLinkedIGHW(NUM_ITEMS), Version::V2);
+
+  const IGHWTOC *lookupToc = main.Find<MaterialResourceNameLookup>();
+  const IGHWTOC *texturesToc = main.Find<Texture>();
+  const IGHWTOC *resourcesToc = main.Find<TextureResource>();
+  TEST_CHECK(lookupToc && texturesToc && resourcesToc);
+  main.Fixup(*lookupToc);
+
+  // Requested entry and entry it points into are swapped
+  const MaterialResourceNameLookup &lookup =
+      lookupToc->Iter<MaterialResourceNameLookup>().at(0);
+  TEST_CHECK(lookup.hash.part1 == 0x1234 && lookup.hash.part2 == 0x5678);
+  TEST_CHECK(reinterpret_cast<const void *>(lookup.lookupPath.Get()) ==
+             texturesToc->data.Get());
+
+  auto textures = texturesToc->Iter<Texture>();
+
+  for (uint32 i = 0; i < NUM_ITEMS; i++) {
+    TEST_CHECK(textures.at(i).offset == i);
+  }
+
+  // Unrelated entry is kept in file endianness
+  auto resources = resourcesToc->Iter<TextureResource>();
+
+  for (uint32 i = 0; i < NUM_ITEMS; i++) {
+    TEST_CHECK(resources.at(i).hash == std::byteswap(i));
+  }
+
+  // Fixup of fixed entry does nothing
+  main.Fixup(*texturesToc);
+  TEST_CHECK(textures.at(1).offset == 1);
+
+  return 0;
+}
+
+static int TestFixupAllMatchesEager() {
+  const std::string data = MakeLinkedIGHW(NUM_ITEMS);
+
+  IGHW eager;
+  eager.FromMemory(data, Version::V2);
+  eager.FixupAll();
+
+  IGHW lazy;
+  lazy.FromMemory(data, Version::V2);
+  lazy.TryIter<Texture>();
+  lazy.FixupAll();
+
+  TEST_CHECK(std::distance(eager.begin(), eager.end()) ==
+             std::distance(lazy.begin(), lazy.end()));
+
+  for (auto e = eager.begin(), l = lazy.begin(); e != eager.end(); e++, l++) {
+    TEST_CHECK(e->id == l->id);
+
+    // Pointers hold addresses of own copy
+    if (e->IsClass<MaterialResourceNameLookup>()) {
+      auto &eLookup = e->Iter<MaterialResourceNameLookup>().at(0);
+      auto &lLookup = l->Iter<MaterialResourceNameLookup>().at(0);
+      TEST_CHECK(eLookup.hash == lLookup.hash);
+      continue;
+    }
+
+    TEST_CHECK(TocData(*e) == TocData(*l));
+  }
+
+  auto resources = lazy.TryIter<TextureResource>();
+  TEST_CHECK(resources.at(NUM_ITEMS - 1).hash == NUM_ITEMS - 1);
+
+  return 0;
+}
+
+int main() { return TestLazyFixup() || TestFixupAllMatchesEager(); }
@@ -0,0 +1,220 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/parallel.hpp"
+#include "insomnia/internal/pipeline.hpp"
+#include "test_common.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void RandomSleep(size_t seed) {
+  std::this_thread::sleep_for(std::chrono::microseconds((seed * 7919) % 200));
+}
+
+static int TestPipelineOrder() {
+  static constexpr size_t NUM_ITEMS = 500;
+  std::vector<size_t> written;
+  std::atomic<size_t> numWorkers = 0;
+
+  RunPipeline(
+      NUM_ITEMS, PipelineOptions{.numWorkers = 4, .queueDepth = 8},
+      [](size_t index) { return std::string(index % 16 + 1, char(index)); },
+      [&] {
+        numWorkers++;
+        return [](size_t index, std::string &input) {
+          RandomSleep(index);
+          return std::make_pair(index, input.size());
+        };
+      },
+      [&](size_t index, std::pair<size_t, size_t> &output) {
+        if (output.first == index && output.second == index % 16 + 1) {
+          written.push_back(index);
+        }
+      });
+
+  TEST_CHECK(numWorkers == 4);
+  TEST_CHECK(written.size() == NUM_ITEMS);
+
+  for (size_t i = 0; i < NUM_ITEMS; i++) {
+    TEST_CHECK(written[i] == i);
+  }
+
+  return 0;
+}
+
+static int TestPipelineMemoryLimit() {
+  size_t numWritten = 0;
+
+  // Items bigger than limit are still let through one by one
+  RunPipeline(
+      16, PipelineOptions{.numWorkers = 2, .memoryLimit = 1},
+      [](size_t) { return std::string(64, 'a'); },
+      [] { return [](size_t, std::string &input) { return input.size(); }; },
+      [&](size_t, size_t &output) { numWritten += output == 64; });
+
+  TEST_CHECK(numWritten == 16);
+  return 0;
+}
+
+static int TestPipelineErrors() {
+  static constexpr size_t FAILING_ITEM = 37;
+  size_t lastWritten = 0;
+
+  TEST_CHECK(Throws<std::runtime_error>([&] {
+    RunPipeline(
+        100, PipelineOptions{.numWorkers = 3},
+        [](size_t) { return std::string("x"); },
+        [] {
+          return [](size_t index, std::string &) {
+            if (index == FAILING_ITEM) {
+              throw std::runtime_error("worker");
+            }
+
+            return index;
+          };
+        },
+        [&](size_t index, size_t &) { lastWritten = index; });
+  }));
+
+  TEST_CHECK(lastWritten < FAILING_ITEM);
+
+  TEST_CHECK(Throws<std::out_of_range>([] {
+    RunPipeline(
+        100, PipelineOptions{.numWorkers = 3},
+        [](size_t index) {
+          if (index == FAILING_ITEM) {
+            throw std::out_of_range("reader");
+          }
+
+          return std::string("x");
+        },
+        [] { return [](size_t index, std::string &) { return index; }; },
+        [](size_t, size_t &) {});
+  }));
+
+  TEST_CHECK(Throws<std::logic_error>([] {
+    RunPipeline(
+        100, PipelineOptions{.numWorkers = 3},
+        [](size_t) { return std::string("x"); },
+        [] { return [](size_t index, std::string &) { return index; }; },
+        [](size_t index, size_t &) {
+          if (index == FAILING_ITEM) {
+            throw std::logic_error("writer");
+          }
+        });
+  }));
+
+  return 0;
+}
+
+static int TestTaskGraphOrder() {
+  std::atomic<int> step = 0;
+  int firstDone = -1;
+  int secondDone = -1;
+  int joinStart = -1;
+  TaskGraph graph;
+
+  auto first = graph.Add([&] {
+    RandomSleep(50);
+    firstDone = step++;
+  });
+  auto second = graph.Add([&] { secondDone = step++; });
+  graph.Add([&] { joinStart = step++; }, {first, second});
+  graph.Run();
+
+  TEST_CHECK(joinStart == 2);
+  TEST_CHECK(firstDone >= 0 && firstDone < 2);
+  TEST_CHECK(secondDone >= 0 && secondDone < 2);
+  TEST_CHECK(Throws<std::out_of_range>([] {
+    TaskGraph invalid;
+    invalid.Add([] {}, {1});
+  }));
+
+  return 0;
+}
+
+static int TestTaskGraphErrors() {
+  std::atomic<bool> dependentRun = false;
+  std::atomic<bool> independentRun = false;
+  TaskGraph graph;
+
+  auto failing = graph.Add([] { throw std::runtime_error("first"); });
+  graph.Add([&] { independentRun = true; });
+  graph.Add([&] { dependentRun = true; }, {failing});
+  graph.Add([] { throw std::logic_error("second"); });
+
+  // First error in order of Add wins
+  TEST_CHECK(Throws<std::runtime_error>([&] { graph.Run(); }));
+  TEST_CHECK(independentRun);
+  TEST_CHECK(!dependentRun);
+
+  return 0;
+}
+
+static int TestWorkerBudget() {
+  static constexpr size_t NUM_SLOTS = 3;
+  WorkerBudget budget(NUM_SLOTS);
+  std::atomic<size_t> numBusy = 0;
+  std::atomic<size_t> maxBusy = 0;
+  std::atomic<size_t> numWorkers = 0;
+  std::atomic<size_t> numWritten = 0;
+  TaskGraph graph;
+
+  // Every pipeline asks for more workers than whole budget
+  for (size_t p = 0; p < 4; p++) {
+    graph.Add([&] {
+      RunPipeline(
+          100, PipelineOptions{.numWorkers = 8, .budget = &budget},
+          [](size_t index) { return std::string(index % 4 + 1, 'a'); },
+          [&] {
+            numWorkers++;
+            return [&](size_t index, std::string &) {
+              const size_t busy = ++numBusy;
+              size_t expected = maxBusy;
+
+              while (busy > expected &&
+                     !maxBusy.compare_exchange_weak(expected, busy)) {
+              }
+
+              RandomSleep(index);
+              numBusy--;
+              return index;
+            };
+          },
+          [&](size_t index, size_t &output) {
+            numWritten += index == output;
+          });
+    });
+  }
+
+  graph.Run();
+
+  TEST_CHECK(numWritten == 400);
+  TEST_CHECK(maxBusy <= NUM_SLOTS);
+  TEST_CHECK(numWorkers == 4 * NUM_SLOTS);
+
+  return 0;
+}
+
+int main() {
+  return TestPipelineOrder() || TestPipelineMemoryLimit() ||
+         TestPipelineErrors() || TestTaskGraphOrder() ||
+         TestTaskGraphErrors() || TestWorkerBudget();
+}
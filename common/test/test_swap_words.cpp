@@ -0,0 +1,62 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/swap_words.hpp"
+#include "test_common.hpp"
+#include <cstring>
+#include <string>
+
+// Every kernel swaps same words as scalar one, at any alignment and
+// leaves trailing bytes untouched.
+static int TestKernels() {
+  auto kernels = SwapWordsKernels();
+  TEST_CHECK(!kernels.empty());
+  TEST_CHECK(strcmp(kernels.front().name, "scalar") == 0);
+
+  std::string source(200, 0);
+
+  for (size_t i = 0; i < source.size(); i++) {
+    source[i] = char(i * 7 + 1);
+  }
+
+  for (size_t offset = 0; offset < 4; offset++) {
+    for (size_t size = 0; size < 150; size++) {
+      std::string expected = source;
+      char *begin = expected.data() + offset;
+
+      for (size_t w = 0; w + 4 <= size; w += 4) {
+        std::swap(begin[w], begin[w + 3]);
+        std::swap(begin[w + 1], begin[w + 2]);
+      }
+
+      for (const SwapWordsKernel &kernel : kernels) {
+        std::string data = source;
+        kernel.fn(data.data() + offset, data.data() + offset + size);
+
+        if (data != expected) {
+          fprintf(stderr, "kernel %s, offset %zu, size %zu\n", kernel.name,
+                  offset, size);
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+int main() { return TestKernels(); }
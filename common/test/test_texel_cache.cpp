@@ -0,0 +1,130 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/texel_cache.hpp"
+#include "test_common.hpp"
+
+static int TestXXH64() {
+  std::string data(100, 0);
+
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = char(i);
+  }
+
+  // Reference values of xxHash 0.8
+  TEST_CHECK(XXH64("") == 0xEF46DB3751D8E999ULL);
+  TEST_CHECK(XXH64("abc") == 0x44BC2CF5AD770999ULL);
+  TEST_CHECK(XXH64(data) == 0x6AC1E58032166597ULL);
+  TEST_CHECK(XXH64(data, 1) != XXH64(data));
+
+  return 0;
+}
+
+static int TestKey() {
+  const uint32 params[]{1, 2, 3};
+  const uint32 otherParams[]{1, 2, 4};
+
+  TEST_CHECK(TexelCache::Key("payload", 7, params) ==
+             TexelCache::Key("payload", 7, params));
+  TEST_CHECK(TexelCache::Key("payload", 7, params) !=
+             TexelCache::Key("payload", 7, otherParams));
+  TEST_CHECK(TexelCache::Key("payload", 7, params) !=
+             TexelCache::Key("payloaD", 7, params));
+  TEST_CHECK(TexelCache::Key("payload", 7, params) !=
+             TexelCache::Key("payload", 8, params));
+
+  const uint64 config =
+      TexelOutputFormatKey(TexelContextFormat::Config, 0, false);
+  TEST_CHECK(config ==
+             TexelOutputFormatKey(TexelContextFormat::Config, 0, false));
+  TEST_CHECK(config !=
+             TexelOutputFormatKey(TexelContextFormat::Config, 1, false));
+  TEST_CHECK(config !=
+             TexelOutputFormatKey(TexelContextFormat::UPNG, 0, false));
+  TEST_CHECK(TexelOutputFormatKey(TexelContextFormat::UPNG, 0, false) !=
+             TexelOutputFormatKey(TexelContextFormat::UPNG, 0, true));
+
+  return 0;
+}
+
+static int TestRoundTrip() {
+  TempDir dir;
+  const TexelCache cache(dir / "cache");
+  TexelMemoryOutput output;
+  output.NewFile("textures/albedo.png");
+  output.SendData("first");
+  output.SendData(std::string_view("\0second", 7));
+  output.NewFile("textures/albedo.mip1.png");
+  cache.Store(42, "textures/albedo.dds", output);
+
+  // Same payload under different name
+  TexelMemoryOutput loaded;
+  TEST_CHECK(cache.Load(42, "other/name.dds", loaded));
+  TEST_CHECK(loaded.files.size() == 2);
+  TEST_CHECK(loaded.files[0].path == "other/name.png");
+  TEST_CHECK(loaded.files[0].data == std::string("first\0second", 12));
+  TEST_CHECK(loaded.files[1].path == "other/name.mip1.png");
+  TEST_CHECK(loaded.files[1].data.empty());
+
+  TexelMemoryOutput missing;
+  TEST_CHECK(!cache.Load(43, "textures/albedo.dds", missing));
+  TEST_CHECK(missing.files.empty());
+
+  // Empty outputs are valid entries
+  cache.Store(44, "empty", TexelMemoryOutput{});
+  TexelMemoryOutput empty;
+  empty.NewFile("stale");
+  TEST_CHECK(cache.Load(44, "empty", empty));
+  TEST_CHECK(empty.files.empty());
+
+  return 0;
+}
+
+static int TestRejected() {
+  TempDir dir;
+  const TexelCache cache(dir / "cache");
+  TexelMemoryOutput output;
+  output.NewFile("unrelated/path.png");
+  output.SendData("data");
+
+  // Files not named after path can't be renamed on load
+  cache.Store(1, "textures/albedo", output);
+  TEST_CHECK(!cache.Load(1, "textures/albedo", output));
+
+  // Truncated entry
+  output.files = {{"textures/albedo.png", std::string(1000, 'a')}};
+  cache.Store(2, "textures/albedo", output);
+
+  for (auto &entry : std::filesystem::directory_iterator(dir.path / "cache")) {
+    std::filesystem::resize_file(entry.path(), 40);
+  }
+
+  TexelMemoryOutput truncated;
+  TEST_CHECK(!cache.Load(2, "textures/albedo", truncated));
+  TEST_CHECK(truncated.files.empty());
+
+  // Disabled cache
+  const TexelCache disabled("");
+  disabled.Store(3, "textures/albedo", output);
+  TEST_CHECK(!disabled.Load(3, "textures/albedo", truncated));
+
+  return 0;
+}
+
+int main() {
+  return TestXXH64() || TestKey() || TestRoundTrip() || TestRejected();
+}
@@ -0,0 +1,71 @@
+/*  InsomniaLib
+    Copyright(C) 2025 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "insomnia/internal/texture.hpp"
+#include "test_common.hpp"
+
+// Single BC1 block, color0 with blue only, color1 black
+static std::string MakeBC1Block(uint32 indices, bool bigEndian) {
+  const uint16 color0 = 0x001f;
+  const uint16 color1 = 0;
+  char block[8];
+  memcpy(block, &color0, 2);
+  memcpy(block + 2, &color1, 2);
+  memcpy(block + 4, &indices, 4);
+  std::string retVal(block, sizeof(block));
+
+  if (bigEndian) {
+    SwapPackedBlocks(retVal);
+  }
+
+  return retVal;
+}
+
+static int TestHasNonZeroBlue() {
+  Texture tex{};
+  tex.format = TextureFormat::BC1;
+
+  // Every texel uses color1
+  const std::string black = MakeBC1Block(0x55555555, false);
+  const std::string blue = MakeBC1Block(0, false);
+  TEST_CHECK(!HasNonZeroBlue(tex, black, false));
+  TEST_CHECK(HasNonZeroBlue(tex, blue, false));
+
+  const std::string blackBE = MakeBC1Block(0x55555555, true);
+  const std::string blueBE = MakeBC1Block(0, true);
+  TEST_CHECK(!HasNonZeroBlue(tex, blackBE, true));
+  TEST_CHECK(HasNonZeroBlue(tex, blueBE, true));
+
+  // Big endian endpoints read without swap put blue into red bits
+  TEST_CHECK(!HasNonZeroBlue(tex, blueBE, false));
+
+  tex.format = TextureFormat::RGBA8;
+  TEST_CHECK(!HasNonZeroBlue(tex, std::string(64, 0), true));
+  TEST_CHECK(HasNonZeroBlue(tex, std::string(63, 0) + '\1', true));
+
+  return 0;
+}
+
+static int TestSwapPackedBlocks() {
+  std::string data("\1\2\3\4\5", 5);
+  SwapPackedBlocks(data);
+  TEST_CHECK(data == std::string("\2\1\4\3\5", 5));
+
+  return 0;
+}
+
+int main() { return TestHasNonZeroBlue() || TestSwapPackedBlocks(); }
@@ -86,11 +86,16 @@ void AppProcessFile(AppContext *ctx) {
   BinReaderRef_e rd(ctx->GetStream());
   IGHW main;
   main.FromStream(rd, Version::V2);
-  auto dataStream = ctx->RequestFile(std::string(ctx->workingFile.GetFolder()) +
-                                     "vfx_system_texel.dat");
-  BinReaderRef_e rdd(*dataStream.Get());
+  const std::string dataPath =
+      std::string(ctx->workingFile.GetFolder()) + "vfx_system_texel.dat";
   IGHW data;
-  data.FromStream(rdd, Version::V2);
+
+  if (!data.FromFile(dataPath, 0, 0, Version::V2)) {
+    auto dataStream = ctx->RequestFile(dataPath);
+    BinReaderRef_e rdd(*dataStream.Get());
+    data.FromStream(rdd, Version::V2);
+  }
+
   auto ectx = ctx->ExtractContext();
 
   IGHWTOCIteratorConst<TextureResource> texturResources;
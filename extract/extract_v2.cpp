@@ -15,7 +15,13 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "gltf_ighw.hpp"
 #include "insomnia/insomnia.hpp"
+#include "insomnia/internal/parallel.hpp"
+#include "insomnia/internal/pipeline.hpp"
+#include "insomnia/internal/read_planner.hpp"
+#include "insomnia/internal/texel_cache.hpp"
+#include "insomnia/internal/texture.hpp"
 #include "project.h"
 #include "pugixml.hpp"
 #include "spike/app_context.hpp"
@@ -24,6 +30,9 @@
 #include "spike/master_printer.hpp"
 #include "spike/reflect/reflector.hpp"
 #include "spike/type/flags.hpp"
+#include <mutex>
+#include <set>
+#include <stdexcept>
 
 MAKE_ENUM(ENUMSCOPE(class Filter, Filter), EMEMBER(Mobys), EMEMBER(Ties),
           EMEMBER(Shrubs), EMEMBER(Foliages), EMEMBER(Zones), EMEMBER(Textures),
@@ -33,13 +42,31 @@ MAKE_ENUM(ENUMSCOPE(class Filter, Filter), EMEMBER(Mobys), EMEMBER(Ties),
 static struct AssetExtract : ReflectorBase<AssetExtract> {
   bool convertShaders = true;
   es::Flags<Filter> extractFilter{0xffffu};
+  std::string cacheDir;
+  uint32 jobs = 1;
+  uint32 queueDepth = 0;
+  uint32 queueMemory = 512;
 } settings;
 
 REFLECT(CLASS(AssetExtract),
         MEMBERNAME(convertShaders, "convert-shaders", "s",
                    ReflDesc{"Convert shaders into XML format."}),
         MEMBERNAME(extractFilter, "extract-filter", "e",
-                   ReflDesc{"Select groups that should be extracted."}), );
+                   ReflDesc{"Select groups that should be extracted."}),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Keep fixed up copies of lookup, shader and zone "
+                            "data and converted textures in this folder for "
+                            "next runs."}),
+        MEMBERNAME(jobs, "jobs", "j",
+                   ReflDesc{"Number of threads converting mobys, ties, shrubs, "
+                            "foliages and zones, shared by all groups, 0 = all "
+                            "cores."}),
+        MEMBERNAME(queueDepth, "queue-depth", "q",
+                   ReflDesc{"Maximum number of assets read ahead of writer per "
+                            "group, 0 = 4 per job."}),
+        MEMBERNAME(queueMemory, "queue-memory", "m",
+                   ReflDesc{"Maximum MiB of asset data read ahead of writer "
+                            "per group."}), );
 
 std::string_view filters[]{
     "^assetlookup.dat$",
@@ -54,69 +81,128 @@ static AppInfo_s appInfo{
 
 AppInfo_s *AppInitModule() { return &appInfo; }
 
-template <> void FByteswapper(IGHWHeader &input, bool) {
-  FByteswapper(input.id);
-  FByteswapper(input.numToc);
-  FByteswapper(input.dataEnd);
+// Extract groups run concurrently, but AppExtractContext writes one file
+// at a time. Held from NewFile until file is completely written.
+static std::mutex outputMutex;
+// NewImage is not known to be thread safe, groups call it from their
+// writers one at a time.
+static std::mutex imageMutex;
+
+// Groups run their pipelines concurrently, settings.jobs is shared by all
+// of them instead of given to each.
+static PipelineOptions GetPipelineOptions() {
+  static WorkerBudget budget(settings.jobs);
+
+  return {
+      .numWorkers = settings.jobs,
+      .budget = &budget,
+      .queueDepth = settings.queueDepth,
+      .memoryLimit = size_t(settings.queueMemory) * 1024 * 1024,
+  };
 }
 
-template <> void FByteswapper(IGHWTOC &input, bool) {
-  FByteswapper(input.id);
-  FByteswapper(input.data);
-}
+struct TextureCache {
+  std::string path;
+  Texture data;
+};
 
-bool IGHWSeekClass(BinReaderRef_e rd, uint32 classId) {
-  rd.SwapEndian(true);
-  IGHWHeader hdr;
-  rd.Read(hdr);
+using TextureRegistry = std::map<uint32, TextureCache>;
 
-  if (hdr.id != hdr.ID) {
-    throw es::InvalidHeaderError(hdr.id);
+struct XMLContextWritter : pugi::xml_writer {
+  XMLContextWritter(AppExtractContext *ctx_) : ctx(ctx_) {}
+  void write(const void *data, size_t size) override {
+    ctx->SendData({static_cast<const char *>(data), size});
   }
+  AppExtractContext *ctx;
+};
 
-  if (hdr.DEADDEAD == 0xDEADDEAD) {
-    throw es::InvalidHeaderError();
+// Sends raw byte ranges of data file into extract context.
+// File is mapped once and slices are passed to SendData directly,
+// so nothing is copied on our side. Falls back to buffered stream reads
+// when file cannot be mapped.
+struct RangeCopier {
+  RangeCopier(AppContext *ctx, const std::string &fileName)
+      : stream(ctx->RequestFile(fileName)) {
+    mapping.Open(std::string(ctx->workingFile.GetFolder()) + fileName);
   }
 
-  for (size_t i = 0; i < hdr.numToc; i++) {
-    IGHWTOC toc;
-    rd.Read(toc);
+  void Copy(AppExtractContext *ectx, size_t offset, size_t size) {
+    if (mapping && offset + size <= mapping.Size()) {
+      static constexpr size_t SLICE_SIZE = 0x4000000;
+      const char *data = mapping.Data() + offset;
+
+      for (size_t i = 0; i < size; i += SLICE_SIZE) {
+        ectx->SendData({data + i, std::min(size - i, SLICE_SIZE)});
+      }
 
-    if (toc.id == classId) {
-      rd.Seek(reinterpret_cast<uint32 &>(toc.data));
-      return true;
+      return;
+    }
+
+    char uniBuffer[0x80000];
+    stream->seekg(offset);
+
+    for (size_t i = 0; i < size; i += sizeof(uniBuffer)) {
+      const size_t chunkSize = std::min(size - i, sizeof(uniBuffer));
+      stream->read(uniBuffer, chunkSize);
+      ectx->SendData({uniBuffer, chunkSize});
     }
   }
 
-  return false;
-}
+  // Returns copy of bytes of data file
+  std::string Load(size_t offset, size_t size) {
+    std::string buffer;
+    const std::string_view data = Read(offset, size, buffer);
 
-struct TextureCache {
-  std::string path;
-  Texture data;
-};
+    if (data.data() != buffer.data()) {
+      buffer = data;
+    }
 
-using TextureRegistry = std::map<uint32, TextureCache>;
+    return buffer;
+  }
 
-struct XMLContextWritter : pugi::xml_writer {
-  XMLContextWritter(AppExtractContext *ctx_) : ctx(ctx_) {}
-  void write(const void *data, size_t size) override {
-    ctx->SendData({static_cast<const char *>(data), size});
+  // Returns bytes of mapped data file, empty when file is not mapped
+  std::string_view View(size_t offset, size_t size) const {
+    if (mapping && offset + size <= mapping.Size()) {
+      return {mapping.Data() + offset, size};
+    }
+
+    return {};
   }
-  AppExtractContext *ctx;
+
+  // Returns bytes of data file, buffer is used when file is not mapped
+  std::string_view Read(size_t offset, size_t size, std::string &buffer) {
+    if (std::string_view data = View(offset, size); data.data()) {
+      return data;
+    }
+
+    buffer.resize(size);
+    stream->seekg(offset);
+    stream->read(buffer.data(), size);
+    return buffer;
+  }
+
+  AppContextStream stream;
+
+private:
+  MappedFile mapping;
 };
 
-void ExtractShaders(AppContext *ctx,
-                    IGHWTOCIteratorConst<ResourceShaders> &shaders,
+void ExtractShaders(AppContext *ctx, const ShaderIndex &shaders,
                     TextureRegistry &reg) {
-  auto stream = ctx->RequestFile("shaders.dat");
+  RangeCopier shaderData(ctx, "shaders.dat");
+  const std::string shadersPath =
+      std::string(ctx->workingFile.GetFolder()) + "shaders.dat";
   IGHW main;
 
   for (auto &item : shaders) {
     const char *shaderPath = nullptr;
-    BinReaderRef_e rd(*stream.Get());
-    rd.SetRelativeOrigin(item.offset);
-    main.FromStream(rd, Version::V2);
+
+    if (!main.FromCache(settings.cacheDir, shadersPath, item.offset, item.size,
+                        Version::V2)) {
+      BinReaderRef_e rd(*shaderData.stream.Get());
+      rd.SetRelativeOrigin(item.offset);
+      main.FromStream(rd, Version::V2);
+    }
     IGHWTOCIteratorConst<Texture> textures;
     IGHWTOCIteratorConst<MaterialResourceNameLookup> lookups;
     IGHWTOCIteratorConst<TextureResource> textureResources;
@@ -125,6 +211,8 @@ void ExtractShaders(AppContext *ctx,
     if (textures.Valid() && lookups.Valid()) {
       auto lookup = lookups.begin();
       shaderPath = lookup->lookupPath;
+      shaders.Insert(item.hash, {shaderPath, {std::begin(lookup->mapHashes),
+                                              std::end(lookup->mapHashes)}});
       size_t curHash = 0;
 
       for (auto h : lookup->mapHashes) {
@@ -157,6 +245,7 @@ void ExtractShaders(AppContext *ctx,
     }
 
     auto ectx = ctx->ExtractContext();
+    std::lock_guard lock(outputMutex);
 
     if (shaderPath) {
       std::string path = "shaders/";
@@ -179,47 +268,60 @@ void ExtractShaders(AppContext *ctx,
       XMLContextWritter xmlwr(ectx);
       doc.save(xmlwr);
     } else {
-      char uniBuffer[0x80000]{};
-      auto restream = [&](auto instream, size_t size) {
-        const size_t numBlocks = size / sizeof(uniBuffer);
-        const size_t restBytes = size % sizeof(uniBuffer);
-
-        for (size_t i = 0; i < numBlocks; i++) {
-          instream->read(uniBuffer, sizeof(uniBuffer));
-          ectx->SendData({uniBuffer, sizeof(uniBuffer)});
-        }
+      shaderData.Copy(ectx, item.offset, item.size);
+    }
+  }
+}
 
-        if (restBytes) {
-          instream->read(uniBuffer, restBytes);
-          ectx->SendData({uniBuffer, restBytes});
-        }
-      };
+// Texture read and looked up in cache, not converted yet
+struct PendingImage {
+  std::string path;
+  Texture info;
+  // High mips (if any) followed by texture data
+  std::string payload;
+  uint64 cacheKey = 0;
+  bool cached = false;
+  TexelMemoryOutput converted{};
+};
 
-      stream->seekg(item.offset);
-      restream(stream.Get(), item.size);
-    }
+// Texel cache key part of configured output format, 0 when disabled.
+static uint64 OutputFormatKey() {
+  return settings.cacheDir.empty()
+             ? 0
+             : TexelOutputFormatKey(TexelContextFormat::Config, 0, false);
+}
+
+// Doesn't call NewImage, safe to call from any thread.
+static PendingImage PrepareTexture(std::string path, const Texture &info,
+                                   std::string payload, uint64 outputFormat) {
+  PendingImage retVal{
+      .path = std::move(path), .info = info, .payload = std::move(payload)};
+  const TexelCache cache(settings.cacheDir);
+
+  if (cache.Enabled()) {
+    const uint32 params[]{
+        uint32(info.format), info.width, info.height, info.numMips,
+        uint32(info.control3.Get<TextureControl3::depth>())};
+    retVal.cacheKey = TexelCache::Key(retVal.payload, outputFormat, params);
+    retVal.cached =
+        cache.Load(retVal.cacheKey, retVal.path, retVal.converted);
   }
+
+  return retVal;
 }
 
-void ExtractTexture(AppExtractContext *ctx, std::string path,
-                    const Texture &info, bool hasHighMipData,
-                    AppContextStream &highMipStream,
-                    AppContextStream &textureStream,
-                    const ResourceHighmips *foundHighMipData,
-                    const ResourceTextures *foundTextureData) {
-  std::string tmpBuffer;
-
-  textureStream->seekg(foundTextureData->offset);
-  if (hasHighMipData) {
-    tmpBuffer.resize(foundHighMipData->size + foundTextureData->size);
-    highMipStream->seekg(foundHighMipData->offset);
-    highMipStream->read(tmpBuffer.data(), foundHighMipData->size);
-
-    textureStream->read(tmpBuffer.data() + foundHighMipData->size,
-                        foundTextureData->size);
-  } else {
-    tmpBuffer.resize(foundTextureData->size);
-    textureStream->read(tmpBuffer.data(), foundTextureData->size);
+// Converted files are sent to output, extract context is not touched.
+// Calls NewImage, keep on writer thread.
+void ExtractTexture(AppContext *ctx, PendingImage &image,
+                    TexelOutput &output) {
+  const TexelCache cache(settings.cacheDir);
+  TexelMemoryOutput &converted = image.converted;
+  const Texture &info = image.info;
+  const std::string &path = image.path;
+
+  if (image.cached) {
+    converted.SendTo(output);
+    return;
   }
 
   TexelTile tile = TexelTile::Linear;
@@ -267,15 +369,24 @@ void ExtractTexture(AppExtractContext *ctx, std::string path,
       .depth = std::max(uint16(1),
                         uint16(info.control3.Get<TextureControl3::depth>())),
       .numMipmaps = uint8(info.numMips),
-      .data = tmpBuffer.data(),
+      .data = image.payload.data(),
+      .texelOutput = cache.Enabled() ? &converted : &output,
   };
 
-  ctx->NewImage(path, tctx);
+  {
+    std::lock_guard lock(imageMutex);
+    ctx->NewImage(path, tctx);
+  }
+
+  if (cache.Enabled()) {
+    cache.Store(image.cacheKey, path, converted);
+    converted.SendTo(output);
+  }
 }
 
 void ExtractTextures(AppContext *ctx, const TextureRegistry &reg,
-                     IGHWTOCIteratorConst<ResourceTextures> textures,
-                     IGHWTOCIteratorConst<ResourceHighmips> highMips) {
+                     const ResourceIndex<ResourceTextures> &textures,
+                     const ResourceIndex<ResourceHighmips> &highMips) {
   auto textureStream = ctx->RequestFile("textures.dat");
   auto highMipStream = ctx->RequestFile("highmips.dat");
   std::map<std::string, bool> duplicates;
@@ -291,208 +402,366 @@ void ExtractTextures(AppContext *ctx, const TextureRegistry &reg,
   }
 
   auto ectx = ctx->ExtractContext();
+  // Registry is sorted by hash, reads are planned by offset instead
+  ReadPlanner textureReads;
+  ReadPlanner highMipReads;
+  static constexpr size_t NO_READ = -1;
+
+  struct PendingTexture {
+    const TextureCache *item;
+    size_t textureRead;
+    size_t highMipRead;
+  };
 
-  for (auto &r : reg) {
-    auto foundTextureData =
-        std::find(textures.begin(), textures.end(), r.first);
+  std::vector<PendingTexture> pending;
+  const uint64 outputFormat = OutputFormatKey();
+
+  auto Flush = [&] {
+    textureReads.Read(*textureStream.Get());
+    highMipReads.Read(*highMipStream.Get());
 
-    auto foundHighMipData =
-        std::find(highMips.begin(), highMips.end(), r.first);
+    for (PendingTexture &p : pending) {
+      std::string data;
 
-    const bool hasTextureData = !es::IsEnd(textures, foundTextureData);
-    const bool hasHighMipData = !es::IsEnd(highMips, foundHighMipData);
+      if (p.highMipRead != NO_READ) {
+        data.append(highMipReads.Get(p.highMipRead));
+      }
 
-    if (!hasTextureData && !hasHighMipData) {
+      data.append(textureReads.Get(p.textureRead));
+      PendingImage image = PrepareTexture("textures/" + p.item->path,
+                                          p.item->data, std::move(data),
+                                          outputFormat);
+      TexelMemoryOutput output;
+      ExtractTexture(ctx, image, output);
+      std::lock_guard lock(outputMutex);
+      output.Flush(ectx);
+    }
+
+    pending.clear();
+    textureReads.Clear();
+    highMipReads.Clear();
+  };
+
+  for (auto &r : reg) {
+    const ResourceTextures *foundTextureData = textures.Find(r.first);
+    const ResourceHighmips *foundHighMipData = highMips.Find(r.first);
+
+    if (!foundTextureData) {
       if (!duplicates.count(r.second.path)) {
         printwarning("Missing data for texture " << r.second.path);
       }
       continue;
     }
 
-    ExtractTexture(ectx, "textures/" + r.second.path, r.second.data,
-                   hasHighMipData, highMipStream, textureStream,
-                   foundHighMipData, foundTextureData);
+    PendingTexture &p = pending.emplace_back();
+    p.item = &r.second;
+    p.textureRead =
+        textureReads.Add(foundTextureData->offset, foundTextureData->size);
+    p.highMipRead = foundHighMipData
+                        ? highMipReads.Add(foundHighMipData->offset,
+                                           foundHighMipData->size)
+                        : NO_READ;
+
+    if (textureReads.Full() || highMipReads.Full()) {
+      Flush();
+    }
   }
+
+  Flush();
 }
 
-void RegionToGltf(IGHW &ighw, AppContext *ctx,
-                  IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                  AppContextStream &shdStream,
-                  IGHWTOCIteratorConst<ResourceTies> ties,
-                  IGHWTOCIteratorConst<ResourceShrubs> shrubs,
-                  IGHWTOCIteratorConst<ResourceFoliages> foliages,
-                  AFileInfo zonePath);
-
-void ExtractZones(AppContext *ctx,
-                  IGHWTOCIteratorConst<ResourceShaders> shaders,
-                  IGHWTOCIteratorConst<ResourceTies> ties,
-                  IGHWTOCIteratorConst<ResourceShrubs> shrubs,
-                  IGHWTOCIteratorConst<ResourceFoliages> foliages,
-                  IGHWTOCIteratorConst<ResourceLighting> ligtmaps,
-                  IGHWTOCIteratorConst<ResourceZones> zones) {
-  auto shdStream = ctx->RequestFile("shaders.dat");
-  auto streamZones = ctx->RequestFile("zones.dat");
-  auto streamLightMaps = ctx->RequestFile("lighting.dat");
-  BinReaderRef_e zonesData(*streamZones.Get());
-  char uniBuffer[0x80000]{};
+GltfOutput RegionToGltf(IGHW &ighw, IGHWWindowReader &buffers, AppContext *ctx,
+                        const ShaderIndex &shaders, AppContextStream &shdStream,
+                        const ResourceIndex<ResourceTies> &ties,
+                        const ResourceIndex<ResourceShrubs> &shrubs,
+                        const ResourceIndex<ResourceFoliages> &foliages,
+                        AFileInfo zonePath);
+
+// Zone in file endianness, view into mapped zones.dat or raw copy when
+// zones.dat cannot be mapped.
+struct ZoneData {
+  std::string_view mapped;
+  std::string raw;
+
+  std::string_view Get() const { return mapped.data() ? mapped : raw; }
+  // Only copied zones count against memory limit
+  size_t size() const { return raw.size(); }
+};
 
-  auto ectx = ctx->ExtractContext();
+// Lightmap textures of zone are read and looked up in cache by zone
+// worker, then converted by zone writer through ExtractTexture, same as
+// registry textures.
+struct ZoneOutput {
+  GltfOutput model;
+  std::vector<PendingImage> textures;
+  ZoneData zone;
+};
 
-  for (auto &item : zones) {
-    std::string workingPath = "zones/";
-    snprintf(uniBuffer, sizeof(uniBuffer), "%.8" PRIX32 ".%.8" PRIX32,
-             item.hash.part1, item.hash.part2);
-    workingPath.append(uniBuffer);
-
-    std::string fileName = workingPath + ".zone.irb";
-    streamZones->seekg(item.offset);
-    IGHW main;
-    main.FromStream(*streamZones.Get(), Version::V2);
-    RegionToGltf(
-        main, ctx, shaders, shdStream, ties, shrubs, foliages,
-        AFileInfo(std::string(ctx->workingFile.GetFolder()) + fileName));
-    ectx->NewFile(fileName);
-
-    auto restream = [&](auto instream, size_t size) {
-      const size_t numBlocks = size / sizeof(uniBuffer);
-      const size_t restBytes = size % sizeof(uniBuffer);
-
-      for (size_t i = 0; i < numBlocks; i++) {
-        instream->read(uniBuffer, sizeof(uniBuffer));
-        ectx->SendData({uniBuffer, sizeof(uniBuffer)});
-      }
+// Every lightmap and shadowmap is read once, even when shared by
+// multiple tie instances. Throws when texture is outside of lighting data.
+static void GatherZoneTextures(IGHW &zone, const ResourceLighting &foundLM,
+                               RangeCopier &lightData,
+                               const std::string &workingPath,
+                               std::string &tmpBuffer, uint64 outputFormat,
+                               std::vector<PendingImage> &textures) {
+  IGHWTOCIteratorConst<ZoneLightmap> zoneLightmaps;
+  IGHWTOCIteratorConst<ZoneShadowMap> zoneShadowmaps;
+  IGHWTOCIteratorConst<ZoneDataLookup> zoneDataLookups;
+  IGHWTOCIteratorConst<TieInstanceV2> tieInstances;
+  IGHWTOCIteratorConst<ZoneMap> zoneMaps;
+  IGHWTOCIteratorConst<TextureResource> zoneMapRes;
+
+  CatchClasses(zone, zoneLightmaps, zoneShadowmaps, zoneDataLookups,
+               tieInstances, zoneMaps, zoneMapRes);
+  size_t curZoneMap = 0;
+
+  auto AddTexture = [&](std::string path, const Texture &info) {
+    if (info.offset > foundLM.size) {
+      throw std::runtime_error("Zone texture " + path +
+                               " is outside of lighting data");
+    }
 
-      if (restBytes) {
-        instream->read(uniBuffer, restBytes);
-        ectx->SendData({uniBuffer, restBytes});
-      }
-    };
+    const size_t size =
+        std::min(TexturePayloadSize(info), size_t(foundLM.size - info.offset));
+    textures.push_back(PrepareTexture(
+        std::move(path), info,
+        std::string(
+            lightData.Read(foundLM.offset + info.offset, size, tmpBuffer)),
+        outputFormat));
+  };
 
-    streamZones->seekg(item.offset);
-    restream(streamZones.Get(), item.size);
+  for (auto &map : zoneMaps) {
+    char textureName[0x40];
+    snprintf(textureName, sizeof(textureName), "/%.8" PRIX32,
+             zoneMapRes.at(curZoneMap++).hash);
+    AddTexture(workingPath + textureName, map);
+  }
+
+  std::set<int16> lightMaps;
 
-    auto foundLM = std::find(ligtmaps.begin(), ligtmaps.end(), item.hash);
-    if (es::IsEnd(ligtmaps, foundLM)) {
+  for (auto &zone0 : tieInstances) {
+    if (zone0.lightMapId == -1 || !lightMaps.emplace(zone0.lightMapId).second) {
       continue;
     }
 
-    IGHW curZone;
-    zonesData.SetRelativeOrigin(item.offset);
-    curZone.FromStream(zonesData, Version::V2);
-    IGHWTOCIteratorConst<ZoneLightmap> zoneLightmaps;
-    IGHWTOCIteratorConst<ZoneShadowMap> zoneShadowmaps;
-    IGHWTOCIteratorConst<ZoneDataLookup> zoneDataLookups;
-    IGHWTOCIteratorConst<TieInstanceV2> tieInstances;
-    IGHWTOCIteratorConst<ZoneMap> zoneMaps;
-    IGHWTOCIteratorConst<TextureResource> zoneMapRes;
-
-    CatchClasses(curZone, zoneLightmaps, zoneShadowmaps, zoneDataLookups,
-                 tieInstances, zoneMaps, zoneMapRes);
-    size_t curZoneMap = 0;
-
-    for (auto &map : zoneMaps) {
-      char textureName[0x40];
-      snprintf(textureName, sizeof(textureName), "/%.8" PRIX32,
-               zoneMapRes.at(curZoneMap++).hash);
-      std::string path = workingPath + textureName;
-      ResourceTextures res;
-      res.offset = map.offset + foundLM->offset;
-      res.size = foundLM->size - map.offset,
-      ExtractTexture(ectx, path, map, false, streamLightMaps, streamLightMaps,
-                     nullptr, &res);
-    }
+    auto &lookup = zoneDataLookups.at(zone0.lightMapId);
+    const char *textureName = lookup.name;
+    AddTexture(((workingPath + "/lightmaps/") + textureName) + ".dds",
+               zoneLightmaps.at(zone0.lightMapId));
+    AddTexture(((workingPath + "/shadowmaps/") + textureName) + ".dds",
+               zoneShadowmaps.at(zone0.lightMapId));
+  }
+}
 
-    for (auto &zone0 : tieInstances) {
-      if (zone0.lightMapId == -1) {
-        continue;
-      }
+// Every zone is read once, same IGHW feeds glTF build and lightmap lookup,
+// vertex buffers and raw output are taken from the same memory.
+// Zones are read ahead, converted on settings.jobs threads and written
+// in table order.
+void ExtractZones(AppContext *ctx, const ShaderIndex &shaders,
+                  const ResourceIndex<ResourceTies> &ties,
+                  const ResourceIndex<ResourceShrubs> &shrubs,
+                  const ResourceIndex<ResourceFoliages> &foliages,
+                  const ResourceIndex<ResourceLighting> &ligtmaps,
+                  const ResourceIndex<ResourceZones> &zones) {
+  RangeCopier zonesData(ctx, "zones.dat");
+  const std::string workDir(ctx->workingFile.GetFolder());
+  const std::string zonesPath = workDir + "zones.dat";
+  auto ectx = ctx->ExtractContext();
+  const size_t numZones = std::distance(zones.begin(), zones.end());
+  PipelineOptions options = GetPipelineOptions();
+
+  // Zones are big, keep only one per job in flight by default
+  if (!options.queueDepth) {
+    options.queueDepth = settings.jobs ? settings.jobs
+                                       : std::thread::hardware_concurrency();
+    options.queueDepth = std::max(options.queueDepth, size_t(1));
+  }
 
-      auto &lookup = zoneDataLookups.at(zone0.lightMapId);
-
-      const char *textureName = lookup.name;
-      {
-        auto &lm0 = zoneLightmaps.at(zone0.lightMapId);
-        std::string path =
-            ((workingPath + "/lightmaps/") + textureName) + ".dds";
-        ResourceTextures res;
-        res.offset = lm0.offset + foundLM->offset;
-        res.size = foundLM->size - lm0.offset;
-        ExtractTexture(ectx, path, lm0, false, streamLightMaps, streamLightMaps,
-                       nullptr, &res);
-      }
+  auto WorkingPath = [](const ResourceZones &item) {
+    char tmpBuff[0x40];
+    snprintf(tmpBuff, sizeof(tmpBuff), "zones/%.8" PRIX32 ".%.8" PRIX32,
+             item.hash.part1, item.hash.part2);
+    return std::string(tmpBuff);
+  };
 
-      {
-        auto &lm0 = zoneShadowmaps.at(zone0.lightMapId);
-        std::string path =
-            ((workingPath + "/shadowmaps/") + textureName) + ".dds";
-        ResourceTextures res;
-        res.offset = lm0.offset + foundLM->offset;
-        res.size = foundLM->size - lm0.offset;
-        ExtractTexture(ectx, path, lm0, false, streamLightMaps, streamLightMaps,
-                       nullptr, &res);
-      }
-    }
-  }
+  const uint64 outputFormat = OutputFormatKey();
+
+  RunPipeline(
+      numZones, options,
+      [&](size_t index) {
+        auto &item = zones.begin()[index];
+        ZoneData zone;
+        zone.mapped = zonesData.View(item.offset, item.size);
+
+        if (!zone.mapped.data()) {
+          zone.raw = zonesData.Load(item.offset, item.size);
+        }
+
+        return zone;
+      },
+      [&] {
+        return [&, lightData = RangeCopier(ctx, "lighting.dat"),
+                shdStream = ctx->RequestFile("shaders.dat"),
+                tmpBuffer = std::string{}](size_t index,
+                                           ZoneData &zone) mutable {
+          auto &item = zones.begin()[index];
+          IGHW main;
+          // Mapped zones are loaded from own copy on write mapping, so
+          // zone is never held twice. Raw copy is parsed with FromMemory.
+          const bool loaded =
+              zone.mapped.data()
+                  ? main.FromCache(settings.cacheDir, zonesPath, item.offset,
+                                   item.size, Version::V2)
+                  : main.FromCache(settings.cacheDir, zonesPath, item.offset,
+                                   zone.raw, Version::V2);
+
+          if (!loaded) {
+            throw std::runtime_error("Cannot load zone " + WorkingPath(item));
+          }
+
+          IGHWWindowReader buffers;
+          buffers.FromMemory(zone.Get());
+          const std::string workingPath = WorkingPath(item);
+          ZoneOutput output;
+          output.model = RegionToGltf(
+              main, buffers, ctx, shaders, shdStream, ties, shrubs, foliages,
+              AFileInfo(workDir + workingPath + ".zone.irb"));
+
+          if (const ResourceLighting *foundLM = ligtmaps.Find(item.hash)) {
+            GatherZoneTextures(main, *foundLM, lightData, workingPath,
+                               tmpBuffer, outputFormat, output.textures);
+          }
+
+          output.zone = std::move(zone);
+          return output;
+        };
+      },
+      [&](size_t index, ZoneOutput &output) {
+        auto &item = zones.begin()[index];
+        GltfOutput &model = output.model;
+        TexelMemoryOutput textures;
+
+        for (PendingImage &image : output.textures) {
+          ExtractTexture(ctx, image, textures);
+        }
+
+        std::lock_guard lock(outputMutex);
+        ctx->NewFile(model.path).str.write(model.data.data(),
+                                           model.data.size());
+        ectx->NewFile(WorkingPath(item) + ".zone.irb");
+        ectx->SendData(output.zone.Get());
+        textures.Flush(ectx);
+      });
 }
 
-void ShrubToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                 AppContext *ctx, AppContextStream &shdStream);
+// Converted model and raw file of single asset
+struct AssetOutput {
+  GltfOutput model;
+  std::string rawPath;
+  std::string raw;
+};
 
-void ExtractShrubs(AppContext *ctx,
-                   IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                   const IGHWTOCIteratorConst<ResourceShrubs> &shrubs) {
-  auto stream = ctx->RequestFile("shrubs.dat");
-  auto shdStream = ctx->RequestFile("shaders.dat");
-  IGHW main;
+// Converts every item and extracts its raw file.
+// Items are read ahead on own thread, converted on settings.jobs threads
+// and written in table order, so output doesn't depend on scheduling.
+// Each item is read and parsed once, raw path is taken from pathLookupId
+// class (0 = none) of the same IGHW.
+template <class Items, class Fn>
+void ConvertAssets(AppContext *ctx, const Items &items, const char *name,
+                   uint32 pathLookupId, Fn &&convert) {
+  RangeCopier data(ctx, name + std::string(".dat"));
+  const size_t numItems = std::distance(items.begin(), items.end());
+  auto ectx = ctx->ExtractContext();
 
-  for (auto &subItem : shrubs) {
-    BinReaderRef_e subRd(*stream.Get());
-    subRd.SetRelativeOrigin(subItem.offset);
-    main.FromStream(*stream.Get(), Version::V2);
-    ShrubToGltf(shaders, main, ctx, shdStream);
-  }
+  RunPipeline(
+      numItems, GetPipelineOptions(),
+      [&](size_t index) {
+        auto &subItem = items.begin()[index];
+        return data.Load(subItem.offset, subItem.size);
+      },
+      [&] {
+        return [&, shdStream = ctx->RequestFile("shaders.dat"),
+                main = IGHW{}](size_t index, std::string &raw) mutable {
+          auto &subItem = items.begin()[index];
+          main.FromMemory(raw, Version::V2);
+          AssetOutput output;
+          output.model = convert(subItem, main, shdStream);
+          const IGHWTOC *pathToc =
+              pathLookupId ? main.Find(pathLookupId) : nullptr;
+
+          if (pathToc) {
+            output.rawPath =
+                reinterpret_cast<const char *>(pathToc->data.Get());
+          } else {
+            char tmpBuff[0x40];
+            snprintf(tmpBuff, sizeof(tmpBuff),
+                     "%s/%.8" PRIX32 ".%.8" PRIX32 ".irb", name,
+                     subItem.hash.part1, subItem.hash.part2);
+            output.rawPath = tmpBuff;
+          }
+
+          output.raw = std::move(raw);
+          return output;
+        };
+      },
+      [&](size_t, AssetOutput &output) {
+        GltfOutput &model = output.model;
+        std::lock_guard lock(outputMutex);
+        ctx->NewFile(model.path).str.write(model.data.data(),
+                                           model.data.size());
+        ectx->NewFile(output.rawPath);
+        ectx->SendData(output.raw);
+      });
 }
 
-void ExtractAnimSets(AppContext *ctx, IGHWTOCIteratorConst<ResourceMobys> mobys,
-                     IGHWTOCIteratorConst<ResourceAnimsets> animsets) {
-  std::map<Hash, std::vector<std::string>> registry;
+GltfOutput ShrubToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                       const std::string &workDir, AppContextStream &shdStream);
 
-  {
-    auto stream = ctx->RequestFile("mobys.dat");
+void ExtractShrubs(AppContext *ctx, const ShaderIndex &shaders,
+                   const ResourceIndex<ResourceShrubs> &shrubs) {
+  const std::string workDir(ctx->workingFile.GetFolder());
+  ConvertAssets(ctx, shrubs, "shrubs", ResourceShrubPathLookupId,
+                [&](auto &, IGHW &main, AppContextStream &shdStream) {
+                  return ShrubToGltf(shaders, main, workDir, shdStream);
+                });
+}
 
-    for (auto &moby : mobys) {
-      BinReaderRef_e subRd(*stream.Get());
-      subRd.SetRelativeOrigin(moby.offset);
-      IGHW item;
-      item.FromStream(subRd, Version::V2);
-      IGHWTOCIteratorConst<MobyV2> model;
+// [animset hash, moby paths]
+using AnimsetRegistry = std::map<Hash, std::vector<std::string>>;
 
-      CatchClasses(item, model);
-      const Hash animHash = model.at(0).animset;
-      if (animHash != Hash{}) {
-        registry[animHash].emplace_back(model.at(0).selfPath);
-      }
-    }
-  }
+// Used when mobys are not extracted, ExtractMobys fills registry otherwise
+AnimsetRegistry ScanAnimSets(AppContext *ctx,
+                             IGHWTOCIteratorConst<ResourceMobys> mobys) {
+  AnimsetRegistry registry;
+  auto stream = ctx->RequestFile("mobys.dat");
 
-  auto stream = ctx->RequestFile("animsets.dat");
-  auto ectx = ctx->ExtractContext();
-  char uniBuffer[0x80000]{};
+  for (auto &moby : mobys) {
+    BinReaderRef_e subRd(*stream.Get());
+    subRd.SetRelativeOrigin(moby.offset);
+    const uint32 classIds[]{MobyV2::ID};
+    IGHW item;
+    item.FromStream(subRd, Version::V2, classIds);
+    IGHWTOCIteratorConst<MobyV2> model;
 
-  auto restream = [&](auto instream, size_t size) {
-    const size_t numBlocks = size / sizeof(uniBuffer);
-    const size_t restBytes = size % sizeof(uniBuffer);
+    CatchClasses(item, model);
 
-    for (size_t i = 0; i < numBlocks; i++) {
-      instream->read(uniBuffer, sizeof(uniBuffer));
-      ectx->SendData({uniBuffer, sizeof(uniBuffer)});
+    if (!model.Valid()) {
+      continue;
     }
 
-    if (restBytes) {
-      instream->read(uniBuffer, restBytes);
-      ectx->SendData({uniBuffer, restBytes});
+    const Hash animHash = model.begin()->animset;
+    if (animHash != Hash{}) {
+      registry[animHash].emplace_back(model.begin()->selfPath);
     }
-  };
+  }
+
+  return registry;
+}
+
+void ExtractAnimSets(AppContext *ctx, const AnimsetRegistry &registry,
+                     IGHWTOCIteratorConst<ResourceAnimsets> animsets) {
+  RangeCopier animsetData(ctx, "animsets.dat");
+  auto ectx = ctx->ExtractContext();
 
   for (auto &set : animsets) {
     if (auto found = registry.find(set.hash); found != registry.end()) {
@@ -501,127 +770,126 @@ void ExtractAnimSets(AppContext *ctx, IGHWTOCIteratorConst<ResourceMobys> mobys,
         std::string animName(
             AFileInfo(setPath.GetFullPathNoExt()).GetFullPathNoExt());
         animName.append(".animset.irb");
+        std::lock_guard lock(outputMutex);
         ectx->NewFile(animName);
-        stream->seekg(set.offset);
-        restream(stream.Get(), set.size);
+        animsetData.Copy(ectx, set.offset, set.size);
       }
     } else {
       char tmpBuff[0x40];
       snprintf(tmpBuff, sizeof(tmpBuff), "%s/%.8" PRIX32 ".%.8" PRIX32 ".irb",
                "animsets", set.hash.part1, set.hash.part2);
+      std::lock_guard lock(outputMutex);
       ectx->NewFile(tmpBuff);
-      stream->seekg(set.offset);
-      restream(stream.Get(), set.size);
+      animsetData.Copy(ectx, set.offset, set.size);
     }
   }
 }
 
-void MobyToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                AppContext *ctx, AppContextStream &shdSteram);
+GltfOutput MobyToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                      const std::string &workDir, AppContextStream &shdStream);
+
+void ExtractMobys(AppContext *ctx, const ShaderIndex &shaders,
+                  IGHWTOCIteratorConst<ResourceMobys> &mobys,
+                  AnimsetRegistry &registry) {
+  const std::string workDir(ctx->workingFile.GetFolder());
+  const size_t numMobys = std::distance(mobys.begin(), mobys.end());
+  // [animset hash, self path] per moby, gathered by workers when
+  // animsets are extracted
+  std::vector<std::pair<Hash, std::string>> animsets(numMobys);
+
+  ConvertAssets(
+      ctx, mobys, "mobys", ResourceMobyPathLookupId,
+      [&](auto &subItem, IGHW &main, AppContextStream &shdStream) {
+        GltfOutput output = MobyToGltf(shaders, main, workDir, shdStream);
+
+        if (!settings.extractFilter[Filter::Animsets]) {
+          return output;
+        }
 
-void ExtractMobys(AppContext *ctx,
-                  IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                  IGHWTOCIteratorConst<ResourceMobys> &mobys) {
-  auto stream = ctx->RequestFile("mobys.dat");
-  auto shdStream = ctx->RequestFile("shaders.dat");
-  IGHW main;
+        if (IGHWTOCIteratorConst<MobyV2> model = main.TryIter<MobyV2>();
+            model.Valid()) {
+          auto &animset = animsets[std::distance(mobys.begin(), &subItem)];
+          animset.first = model.begin()->animset;
+          animset.second = model.begin()->selfPath;
+        }
 
-  for (auto &subItem : mobys) {
-    BinReaderRef_e subRd(*stream.Get());
-    subRd.SetRelativeOrigin(subItem.offset);
-    main.FromStream(*stream.Get(), Version::V2);
-    MobyToGltf(shaders, main, ctx, shdStream);
+        return output;
+      });
+
+  for (auto &[animHash, selfPath] : animsets) {
+    if (animHash != Hash{}) {
+      registry[animHash].emplace_back(std::move(selfPath));
+    }
   }
 }
 
-void TieToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-               AppContext *ctx, AppContextStream &shdStream);
+GltfOutput TieToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                     const std::string &workDir, AppContextStream &shdStream);
 
-void ExtractTies(AppContext *ctx,
-                 IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                 const IGHWTOCIteratorConst<ResourceTies> &ties) {
-  auto stream = ctx->RequestFile("ties.dat");
-  auto shdStream = ctx->RequestFile("shaders.dat");
-  IGHW main;
-
-  for (auto &subItem : ties) {
-    BinReaderRef_e subRd(*stream.Get());
-    subRd.SetRelativeOrigin(subItem.offset);
-    main.FromStream(*stream.Get(), Version::V2);
-    TieToGltf(shaders, main, ctx, shdStream);
-  }
+void ExtractTies(AppContext *ctx, const ShaderIndex &shaders,
+                 const ResourceIndex<ResourceTies> &ties) {
+  const std::string workDir(ctx->workingFile.GetFolder());
+  ConvertAssets(ctx, ties, "ties", ResourceTiePathLookupId,
+                [&](auto &, IGHW &main, AppContextStream &shdStream) {
+                  return TieToGltf(shaders, main, workDir, shdStream);
+                });
 }
 
-void FoliageToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                   AppContext *ctx, AppContextStream &shdStream,
-                   AFileInfo path);
-
-void ExtractFoliages(AppContext *ctx,
-                     IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                     const IGHWTOCIteratorConst<ResourceFoliages> &foliages) {
-  auto stream = ctx->RequestFile("foliages.dat");
-  auto shdStream = ctx->RequestFile("shaders.dat");
-  IGHW main;
+GltfOutput FoliageToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                         AppContextStream &shdStream, AFileInfo path);
 
-  for (auto &subItem : foliages) {
-    BinReaderRef_e subRd(*stream.Get());
-    subRd.SetRelativeOrigin(subItem.offset);
-    main.FromStream(*stream.Get(), Version::V2);
-    char tmpBuff[0x40];
-    snprintf(tmpBuff, sizeof(tmpBuff),
-             "foliage/%.8" PRIX32 ".%.8" PRIX32 ".irb", subItem.hash.part1,
-             subItem.hash.part2);
-    FoliageToGltf(
-        shaders, main, ctx, shdStream,
-        AFileInfo(std::string(ctx->workingFile.GetFolder()) + tmpBuff));
-  }
+void ExtractFoliages(AppContext *ctx, const ShaderIndex &shaders,
+                     const ResourceIndex<ResourceFoliages> &foliages) {
+  const std::string workDir(ctx->workingFile.GetFolder());
+  ConvertAssets(
+      ctx, foliages, "foliages", 0,
+      [&](auto &subItem, IGHW &main, AppContextStream &shdStream) {
+        char tmpBuff[0x40];
+        snprintf(tmpBuff, sizeof(tmpBuff),
+                 "foliage/%.8" PRIX32 ".%.8" PRIX32 ".irb", subItem.hash.part1,
+                 subItem.hash.part2);
+        return FoliageToGltf(shaders, main, shdStream,
+                             AFileInfo(workDir + tmpBuff));
+      });
 }
 
 void AppProcessFile(AppContext *ctx) {
-  BinReaderRef_e rd(ctx->GetStream());
   IGHW main;
-  main.FromStream(rd, Version::V2);
-  char uniBuffer[0x80000]{};
-  auto ectx = ctx->ExtractContext();
-
-  auto restream = [&](auto instream, size_t size) {
-    const size_t numBlocks = size / sizeof(uniBuffer);
-    const size_t restBytes = size % sizeof(uniBuffer);
-
-    for (size_t i = 0; i < numBlocks; i++) {
-      instream->read(uniBuffer, sizeof(uniBuffer));
-      ectx->SendData({uniBuffer, sizeof(uniBuffer)});
-    }
 
-    if (restBytes) {
-      instream->read(uniBuffer, restBytes);
-      ectx->SendData({uniBuffer, restBytes});
-    }
-  };
+  if (!main.FromCache(settings.cacheDir,
+                      std::string(ctx->workingFile.GetFullPath()), 0, 0,
+                      Version::V2)) {
+    BinReaderRef_e rd(ctx->GetStream());
+    main.FromStream(rd, Version::V2);
+  }
+  auto ectx = ctx->ExtractContext();
 
   TextureRegistry textureRegistry;
-  IGHWTOCIteratorConst<ResourceTextures> textures;
-  IGHWTOCIteratorConst<ResourceHighmips> highMips;
-  IGHWTOCIteratorConst<ResourceZones> zones;
-  IGHWTOCIteratorConst<ResourceLighting> lightmaps;
+  const ResourceIndex textures(main.TryIter<ResourceTextures>());
+  const ResourceIndex highMips(main.TryIter<ResourceHighmips>());
+  const ResourceIndex zones(main.TryIter<ResourceZones>());
+  const ResourceIndex lightmaps(main.TryIter<ResourceLighting>());
+  const ShaderIndex shaders(main.TryIter<ResourceShaders>());
+  const ResourceIndex ties(main.TryIter<ResourceTies>());
+  const ResourceIndex shrubs(main.TryIter<ResourceShrubs>());
+  const ResourceIndex foliages(main.TryIter<ResourceFoliages>());
   IGHWTOCIteratorConst<ResourceAnimsets> animsets;
   IGHWTOCIteratorConst<ResourceMobys> mobys;
-  IGHWTOCIteratorConst<ResourceShaders> shaders;
-  IGHWTOCIteratorConst<ResourceTies> ties;
-  IGHWTOCIteratorConst<ResourceShrubs> shrubs;
-  IGHWTOCIteratorConst<ResourceFoliages> foliages;
+  AnimsetRegistry animsetRegistry;
 
   auto ExtractWithLookup = [&](auto lookupId, auto iter, auto name) {
-    std::string reqName = name + std::string(".dat");
-    auto stream = ctx->RequestFile(reqName);
+    RangeCopier data(ctx, name + std::string(".dat"));
 
     for (auto &subItem : iter) {
-      BinReaderRef_e subRd(*stream.Get());
+      BinReaderRef_e subRd(*data.stream.Get());
       subRd.SetRelativeOrigin(subItem.offset);
-      if (IGHWSeekClass(subRd, lookupId)) {
-        std::string fileName;
-        subRd.ReadString(fileName);
-        ectx->NewFile(fileName);
+      const uint32 classIds[]{lookupId};
+      IGHW item;
+      item.FromStream(subRd, Version::V2, classIds);
+      std::lock_guard lock(outputMutex);
+
+      if (const IGHWTOC *pathToc = item.Find(lookupId)) {
+        ectx->NewFile(reinterpret_cast<const char *>(pathToc->data.Get()));
       } else {
         char tmpBuff[0x40];
         snprintf(tmpBuff, sizeof(tmpBuff), "%s/%.8" PRIX32 ".%.8" PRIX32 ".irb",
@@ -629,83 +897,81 @@ void AppProcessFile(AppContext *ctx) {
         ectx->NewFile(tmpBuff);
       }
 
-      stream->seekg(subItem.offset);
-      restream(stream.Get(), subItem.size);
+      data.Copy(ectx, subItem.offset, subItem.size);
     }
   };
 
   auto ExtractSet = [&](auto iter, auto name) {
-    std::string reqName = name + std::string(".dat");
-    auto stream = ctx->RequestFile(reqName);
+    RangeCopier data(ctx, name + std::string(".dat"));
 
     for (auto &subItem : iter) {
       char tmpBuff[0x40];
       snprintf(tmpBuff, sizeof(tmpBuff), "%s/%.8" PRIX32 ".%.8" PRIX32 ".irb",
                name, subItem.hash.part1, subItem.hash.part2);
+      std::lock_guard lock(outputMutex);
       ectx->NewFile(tmpBuff);
-      stream->seekg(subItem.offset);
-      restream(stream.Get(), subItem.size);
+      data.Copy(ectx, subItem.offset, subItem.size);
     }
   };
 
-  auto ExtractCommon = [&](const IGHWTOC &item) {
-    switch (item.id) {
-    case ResourceMobys::ID:
-      mobys = item.Iter<ResourceMobys>();
-      if (settings.extractFilter[Filter::Mobys]) {
-        ExtractMobys(ctx, shaders, mobys);
-        ExtractWithLookup(ResourceMobyPathLookupId, mobys, "mobys");
-      }
-      break;
-    case ResourceCinematics::ID:
-      if (settings.extractFilter[Filter::Cinematics]) {
-        ExtractWithLookup(ResourceCinematicPathLookupId,
-                          item.Iter<ResourceCinematics>(), "cinematics");
-      }
-      break;
-
-    case ResourceCubemap::ID:
-      if (settings.extractFilter[Filter::Cubemaps]) {
-        ExtractSet(item.Iter<ResourceCubemap>(), "cubemaps");
-      }
-      break;
-
-    default:
-      break;
-    }
+  IGHWTOCIteratorConst<ResourceCinematics> cinematics;
+  IGHWTOCIteratorConst<ResourceCubemap> cubemaps;
+  CatchClasses(main, animsets, mobys, cinematics, cubemaps);
+
+  // Groups are independent except textures, that need registry filled by
+  // shaders, models, that convert materials from shader cache prefilled
+  // by shaders, and animsets, that need moby paths.
+  TaskGraph groups;
+  auto Group = [&](Filter filter, auto &&fn, std::vector<size_t> deps = {}) {
+    return groups.Add(
+        [filter, fn] {
+          if (settings.extractFilter[filter]) {
+            fn();
+          }
+        },
+        std::move(deps));
   };
 
-  CatchClassesLambda(main, ExtractCommon, textures, highMips, zones, lightmaps,
-                     animsets, shaders, ties, shrubs, foliages);
-
-  if (settings.extractFilter[Filter::Shrubs]) {
-    ExtractShrubs(ctx, shaders, shrubs);
-    ExtractWithLookup(ResourceShrubPathLookupId, shrubs, "shrubs");
-  }
-
-  if (settings.extractFilter[Filter::Foliages]) {
-    ExtractFoliages(ctx, shaders, foliages);
-    ExtractSet(foliages, "foliages");
-  }
-
-  if (settings.extractFilter[Filter::Ties]) {
-    ExtractTies(ctx, shaders, ties);
-    ExtractWithLookup(ResourceTiePathLookupId, ties, "ties");
-  }
-
-  if (settings.extractFilter[Filter::Shaders]) {
+  const size_t shadersTask = Group(Filter::Shaders, [&] {
     ExtractShaders(ctx, shaders, textureRegistry);
-  }
-
-  if (settings.extractFilter[Filter::Animsets]) {
-    ExtractAnimSets(ctx, mobys, animsets);
-  }
-
-  if (settings.extractFilter[Filter::Textures]) {
-    ExtractTextures(ctx, textureRegistry, textures, highMips);
-  }
+  });
+  const size_t mobysTask = Group(
+      Filter::Mobys,
+      [&] { ExtractMobys(ctx, shaders, mobys, animsetRegistry); },
+      {shadersTask});
+  Group(Filter::Cinematics, [&] {
+    ExtractWithLookup(ResourceCinematicPathLookupId, cinematics,
+                      "cinematics");
+  });
+  Group(Filter::Cubemaps, [&] { ExtractSet(cubemaps, "cubemaps"); });
+  Group(
+      Filter::Shrubs, [&] { ExtractShrubs(ctx, shaders, shrubs); },
+      {shadersTask});
+  Group(
+      Filter::Foliages, [&] { ExtractFoliages(ctx, shaders, foliages); },
+      {shadersTask});
+  Group(
+      Filter::Ties, [&] { ExtractTies(ctx, shaders, ties); }, {shadersTask});
+  Group(
+      Filter::Animsets,
+      [&] {
+        if (!settings.extractFilter[Filter::Mobys]) {
+          animsetRegistry = ScanAnimSets(ctx, mobys);
+        }
 
-  if (settings.extractFilter[Filter::Zones]) {
-    ExtractZones(ctx, shaders, ties, shrubs, foliages, lightmaps, zones);
-  }
+        ExtractAnimSets(ctx, animsetRegistry, animsets);
+      },
+      {mobysTask});
+  Group(
+      Filter::Textures,
+      [&] { ExtractTextures(ctx, textureRegistry, textures, highMips); },
+      {shadersTask});
+  Group(
+      Filter::Zones,
+      [&] {
+        ExtractZones(ctx, shaders, ties, shrubs, foliages, lightmaps, zones);
+      },
+      {shadersTask});
+
+  groups.Run();
 }
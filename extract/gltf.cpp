@@ -1,43 +1,90 @@
 #include "gltf_ighw.hpp"
+#include "insomnia/internal/read_planner.hpp"
 #include "insomnia/internal/vertex.hpp"
 #include "nlohmann/json.hpp"
 #include "spike/app_context.hpp"
 #include "spike/io/binreader_stream.hpp"
+#include "spike/master_printer.hpp"
 #include "spike/uni/rts.hpp"
+#include <mutex>
+#include <set>
+#include <sstream>
 
-void MobyToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                AppContext *ctx, AppContextStream &shdStream) {
+const ShaderInfo *
+ShaderCache::Get(Hash hash, const ResourceIndex<ResourceShaders> &shaders,
+                 AppContextStream &shdStream) {
+  {
+    std::shared_lock lock(mutex);
+    if (auto found = items.find(hash); found != items.end()) {
+      return &found->second;
+    }
+  }
+
+  const ResourceShaders *found = shaders.Find(hash);
+
+  if (!found) {
+    return nullptr;
+  }
+
+  // Loaded outside of lock, duplicate loads of same shader are harmless
+  IGHW shaderMain;
+  {
+    BinReaderRef_e rd(*shdStream.Get());
+    rd.SetRelativeOrigin(found->offset);
+    const uint32 classIds[]{MaterialResourceNameLookup::ID};
+    shaderMain.FromStream(rd, Version::V2, classIds);
+  }
+  IGHWTOCIteratorConst<MaterialResourceNameLookup> lookups;
+  CatchClasses(shaderMain, lookups);
+  ShaderInfo info;
+
+  if (lookups.Valid()) {
+    const MaterialResourceNameLookup *lookup = lookups.begin();
+    info.name = lookup->lookupPath.Get();
+    info.mapHashes.assign(std::begin(lookup->mapHashes),
+                          std::end(lookup->mapHashes));
+  } else {
+    info.name = std::to_string(hash.part1);
+  }
+
+  std::unique_lock lock(mutex);
+  return &items.try_emplace(hash, std::move(info)).first->second;
+}
+
+void ShaderCache::Insert(Hash hash, ShaderInfo info) {
+  std::unique_lock lock(mutex);
+  items.try_emplace(hash, std::move(info));
+}
+
+static GltfOutput SaveGltf(GLTFModel &main, std::string path) {
+  std::stringstream str;
+  main.FinishAndSave(str, "");
+  return {std::move(path), std::move(str).str()};
+}
+
+GltfOutput MobyToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                      const std::string &workDir, AppContextStream &shdStream) {
   IGHWTOCIteratorConst<MobyV2> mobys;
   IGHWTOCIteratorConst<VertexBuffer> vertexBuffers;
   IGHWTOCIteratorConst<IndexBuffer> indexBuffers;
   IGHWTOCIteratorConst<ShaderResourceLookup> shaderLookups;
   AFileInfo mobyPath;
 
-  auto CatchFileName = [&mobyPath, ctx](const IGHWTOC &toc) {
-    if (toc.id == ResourceMobyPathLookupId) {
-      mobyPath.Load(std::string(ctx->workingFile.GetFolder()) +
-                    reinterpret_cast<const char *>(toc.data.Get()));
-    }
-  };
+  if (const IGHWTOC *pathToc = ighw.Find(ResourceMobyPathLookupId)) {
+    mobyPath.Load(workDir +
+                  reinterpret_cast<const char *>(pathToc->data.Get()));
+  }
 
-  CatchClassesLambda(ighw, CatchFileName, mobys, vertexBuffers, indexBuffers,
-                     shaderLookups);
+  CatchClasses(ighw, mobys, vertexBuffers, indexBuffers, shaderLookups);
 
-  IGHW shaderMain;
   GLTFModel main;
 
   for (const ShaderResourceLookup &lookup : shaderLookups) {
-    auto found = std::find(shaders.begin(), shaders.end(), lookup.hash);
+    const ShaderInfo *found = shaders.Get(lookup.hash, shdStream);
     gltf::Material &gmat = main.materials.emplace_back();
 
-    if (found != shaders.end()) {
-      BinReaderRef_e rd(*shdStream.Get());
-      rd.SetRelativeOrigin(found->offset);
-      shaderMain.FromStream(rd, Version::V2);
-      IGHWTOCIteratorConst<MaterialResourceNameLookup> lookups;
-      CatchClasses(shaderMain, lookups);
-      const MaterialResourceNameLookup *lookup = lookups.begin();
-      gmat.name = lookup->lookupPath.Get();
+    if (found) {
+      gmat.name = found->name;
     } else {
       gmat.name = std::to_string(lookup.hash.part1);
     }
@@ -288,13 +335,12 @@ void MobyToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
     }
   }
 
-  main.FinishAndSave(ctx->NewFile(mobyPath.ChangeExtension2("glb")).str, "");
+  return SaveGltf(main, mobyPath.ChangeExtension2("glb"));
 }
 
 template <class Ty>
 void ShadersToGltf(GLTF &main, IGHWTOCIteratorConst<Ty> shaderLookups,
-                   IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                   AppContextStream &shdStream,
+                   const ShaderIndex &shaders, AppContextStream &shdStream,
                    std::map<Hash, uint32> &materialRemaps) {
   for (const Ty &lookup : shaderLookups) {
     if (auto found = materialRemaps.find(lookup.hash);
@@ -303,26 +349,18 @@ void ShadersToGltf(GLTF &main, IGHWTOCIteratorConst<Ty> shaderLookups,
     }
 
     materialRemaps.emplace(lookup.hash, materialRemaps.size());
-    auto found = std::find(shaders.begin(), shaders.end(), lookup.hash);
+    const ShaderInfo *found = shaders.Get(lookup.hash, shdStream);
     gltf::Material &gmat = main.materials.emplace_back();
 
-    if (found != shaders.end()) {
-      BinReaderRef_e rd(*shdStream.Get());
-      rd.SetRelativeOrigin(found->offset);
-      IGHW shaderMain;
-      shaderMain.FromStream(rd, Version::V2);
-      IGHWTOCIteratorConst<MaterialResourceNameLookup> lookups;
-      CatchClasses(shaderMain, lookups);
-      const MaterialResourceNameLookup *lookup = lookups.begin();
-      gmat.name = lookup->lookupPath.Get();
+    if (found) {
+      gmat.name = found->name;
     } else {
       gmat.name = std::to_string(lookup.hash.part1);
     }
   }
 }
 
-size_t TieToGltf(GLTFModel &main,
-                 IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
+size_t TieToGltf(GLTFModel &main, const ShaderIndex &shaders, IGHW &ighw,
                  AppContextStream &shdStream,
                  std::map<Hash, uint32> &materialRemaps) {
   IGHWTOCIteratorConst<TieV2> ties;
@@ -331,14 +369,11 @@ size_t TieToGltf(GLTFModel &main,
   IGHWTOCIteratorConst<ShaderResourceLookup> shaderLookups;
   AFileInfo tiePath;
 
-  auto CatchFileName = [&tiePath](const IGHWTOC &toc) {
-    if (toc.id == ResourceTiePathLookupId) {
-      tiePath.Load(reinterpret_cast<const char *>(toc.data.Get()));
-    }
-  };
+  if (const IGHWTOC *pathToc = ighw.Find(ResourceTiePathLookupId)) {
+    tiePath.Load(reinterpret_cast<const char *>(pathToc->data.Get()));
+  }
 
-  CatchClassesLambda(ighw, CatchFileName, ties, vertexBuffers, indexBuffers,
-                     shaderLookups);
+  CatchClasses(ighw, ties, vertexBuffers, indexBuffers, shaderLookups);
   ShadersToGltf(main, shaderLookups, shaders, shdStream, materialRemaps);
 
   assert(std::distance(ties.begin(), ties.end()) == 1);
@@ -418,30 +453,24 @@ size_t TieToGltf(GLTFModel &main,
   return main.nodes.size() - 1;
 }
 
-void TieToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-               AppContext *ctx, AppContextStream &shdStream) {
+GltfOutput TieToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                     const std::string &workDir, AppContextStream &shdStream) {
 
   AFileInfo tiePath;
 
-  auto CatchFileName = [&tiePath, ctx](const IGHWTOC &toc) {
-    if (toc.id == ResourceTiePathLookupId) {
-      tiePath.Load(std::string(ctx->workingFile.GetFolder()) +
-                   reinterpret_cast<const char *>(toc.data.Get()));
-    }
-  };
-
-  CatchClassesLambda(ighw, CatchFileName);
+  if (const IGHWTOC *pathToc = ighw.Find(ResourceTiePathLookupId)) {
+    tiePath.Load(workDir + reinterpret_cast<const char *>(pathToc->data.Get()));
+  }
 
   GLTFModel main;
   std::map<Hash, uint32> materialRemaps;
 
   TieToGltf(main, shaders, ighw, shdStream, materialRemaps);
 
-  main.FinishAndSave(ctx->NewFile(tiePath.ChangeExtension2("glb")).str, "");
+  return SaveGltf(main, tiePath.ChangeExtension2("glb"));
 }
 
-size_t ShrubToGltf(GLTFModel &main,
-                   IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
+size_t ShrubToGltf(GLTFModel &main, const ShaderIndex &shaders, IGHW &ighw,
                    AppContextStream &shdStream,
                    std::map<Hash, uint32> &materialRemaps) {
   IGHWTOCIteratorConst<ShrubV2> shrubs;
@@ -450,14 +479,11 @@ size_t ShrubToGltf(GLTFModel &main,
   IGHWTOCIteratorConst<ShaderResourceLookup> shaderLookups;
   AFileInfo shrubPath;
 
-  auto CatchFileName = [&shrubPath](const IGHWTOC &toc) {
-    if (toc.id == ResourceShrubPathLookupId) {
-      shrubPath.Load(reinterpret_cast<const char *>(toc.data.Get()));
-    }
-  };
+  if (const IGHWTOC *pathToc = ighw.Find(ResourceShrubPathLookupId)) {
+    shrubPath.Load(reinterpret_cast<const char *>(pathToc->data.Get()));
+  }
 
-  CatchClassesLambda(ighw, CatchFileName, shrubs, vertexBuffers, indexBuffers,
-                     shaderLookups);
+  CatchClasses(ighw, shrubs, vertexBuffers, indexBuffers, shaderLookups);
   ShadersToGltf(main, shaderLookups, shaders, shdStream, materialRemaps);
 
   assert(std::distance(shrubs.begin(), shrubs.end()) == 1);
@@ -527,30 +553,26 @@ size_t ShrubToGltf(GLTFModel &main,
   return main.nodes.size() - 1;
 }
 
-void ShrubToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                 AppContext *ctx, AppContextStream &shdStream) {
+GltfOutput ShrubToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                       const std::string &workDir,
+                       AppContextStream &shdStream) {
 
   AFileInfo shrubPath;
 
-  auto CatchFileName = [&shrubPath, ctx](const IGHWTOC &toc) {
-    if (toc.id == ResourceShrubPathLookupId) {
-      shrubPath.Load(std::string(ctx->workingFile.GetFolder()) +
-                     reinterpret_cast<const char *>(toc.data.Get()));
-    }
-  };
-
-  CatchClassesLambda(ighw, CatchFileName);
+  if (const IGHWTOC *pathToc = ighw.Find(ResourceShrubPathLookupId)) {
+    shrubPath.Load(workDir +
+                   reinterpret_cast<const char *>(pathToc->data.Get()));
+  }
 
   GLTFModel main;
   std::map<Hash, uint32> materialRemaps;
 
   ShrubToGltf(main, shaders, ighw, shdStream, materialRemaps);
 
-  main.FinishAndSave(ctx->NewFile(shrubPath.ChangeExtension2("glb")).str, "");
+  return SaveGltf(main, shrubPath.ChangeExtension2("glb"));
 }
 
-size_t FoliageToGltf(GLTFModel &main,
-                     IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
+size_t FoliageToGltf(GLTFModel &main, const ShaderIndex &shaders, IGHW &ighw,
                      AppContextStream &shdStream,
                      std::map<Hash, uint32> &materialRemaps) {
   IGHWTOCIteratorConst<FoliageV2> foliages;
@@ -636,14 +658,13 @@ size_t FoliageToGltf(GLTFModel &main,
   return folNodeIndex;
 }
 
-void FoliageToGltf(IGHWTOCIteratorConst<ResourceShaders> &shaders, IGHW &ighw,
-                   AppContext *ctx, AppContextStream &shdStream,
-                   AFileInfo path) {
+GltfOutput FoliageToGltf(const ShaderIndex &shaders, IGHW &ighw,
+                         AppContextStream &shdStream, AFileInfo path) {
   GLTFModel main;
   std::map<Hash, uint32> materialRemaps;
   FoliageToGltf(main, shaders, ighw, shdStream, materialRemaps);
 
-  main.FinishAndSave(ctx->NewFile(path.ChangeExtension2("glb")).str, "");
+  return SaveGltf(main, path.ChangeExtension2("glb"));
 }
 
 void Instantiate(IMGLTF &main, gltf::Node &glNode,
@@ -704,10 +725,59 @@ void Instantiate(IMGLTF &main, gltf::Node &glNode,
   }
 }
 
-void GatherRegionTies(IMGLTF &main, AppContext *ctx,
-                      IGHWTOCIteratorConst<ResourceShaders> &shaders,
+// Converts assets of lookups that are not converted yet.
+// Reads are sorted by offset, assets are converted in lookup order.
+template <class Lookups, class Resources, class Fn>
+static void ConvertRegionAssets(AppContextStream &stream,
+                                const Lookups &lookups,
+                                const Resources &resources,
+                                std::map<Hash, IMGLTF::NodeInstances> &nodes,
+                                Fn &&convert) {
+  ReadPlanner reads;
+  std::vector<Hash> pending;
+  std::set<Hash> queued;
+  IGHW assetData;
+
+  auto Flush = [&] {
+    reads.Read(*stream.Get());
+
+    for (size_t i = 0; i < pending.size(); i++) {
+      assetData.FromMemory(reads.Get(i), Version::V2);
+      nodes[pending[i]].nodeIndex = convert(assetData);
+    }
+
+    pending.clear();
+    reads.Clear();
+  };
+
+  for (auto &lookup : lookups) {
+    if (nodes[lookup.hash].nodeIndex > -1 ||
+        !queued.emplace(lookup.hash).second) {
+      continue;
+    }
+
+    auto found = resources.Find(lookup.hash);
+
+    if (!found) {
+      PrintWarning("Region asset ", lookup.hash.part1, ":", lookup.hash.part2,
+                   " not found in asset lookup, skipped");
+      continue;
+    }
+
+    reads.Add(found->offset, found->size);
+    pending.emplace_back(lookup.hash);
+
+    if (reads.Full()) {
+      Flush();
+    }
+  }
+
+  Flush();
+}
+
+void GatherRegionTies(IMGLTF &main, AppContext *ctx, const ShaderIndex &shaders,
                       AppContextStream &shdStream,
-                      IGHWTOCIteratorConst<ResourceTies> ties,
+                      const ResourceIndex<ResourceTies> &ties,
                       IGHWTOCIteratorConst<TieInstanceV2> tieInstances,
                       IGHWTOCIteratorConst<ZoneTieLookup> tieLookups,
                       const std::string &workDir) {
@@ -722,26 +792,14 @@ void GatherRegionTies(IMGLTF &main, AppContext *ctx,
   }
 
   auto tieStream = ctx->RequestFile(workDir + "ties.dat");
-  BinReaderRef_e subRd(*tieStream.Get());
-
-  for (auto &tie : tieLookups) {
-    if (main.ties[tie.hash].nodeIndex > -1) {
-      continue;
-    }
-    auto foundTie = std::find(ties.begin(), ties.end(), tie.hash);
-    subRd.SetRelativeOrigin(foundTie->offset);
-    IGHW tieData;
-    tieData.FromStream(subRd, Version::V2);
-    const size_t nodeIndex =
-        TieToGltf(main, shaders, tieData, shdStream, main.materialRemaps);
-    main.ties[tie.hash].nodeIndex = nodeIndex;
-  }
+  ConvertRegionAssets(tieStream, tieLookups, ties, main.ties, [&](IGHW &data) {
+    return TieToGltf(main, shaders, data, shdStream, main.materialRemaps);
+  });
 }
 
 void GatherRegionShrubs(IMGLTF &main, AppContext *ctx,
-                        IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                        AppContextStream &shdStream,
-                        IGHWTOCIteratorConst<ResourceShrubs> shrubs,
+                        const ShaderIndex &shaders, AppContextStream &shdStream,
+                        const ResourceIndex<ResourceShrubs> &shrubs,
                         IGHWTOCIteratorConst<ShrubV2Instance> shrubInstances,
                         IGHWTOCIteratorConst<ZoneShrubLookup> shrubLookups,
                         const std::string &workDir) {
@@ -760,26 +818,16 @@ void GatherRegionShrubs(IMGLTF &main, AppContext *ctx,
   }
 
   auto shrubStream = ctx->RequestFile(workDir + "shrubs.dat");
-  BinReaderRef_e subRd(*shrubStream.Get());
-
-  for (auto &shrub : shrubLookups) {
-    if (main.shrubs[shrub.hash].nodeIndex > -1) {
-      continue;
-    }
-    auto foundShrub = std::find(shrubs.begin(), shrubs.end(), shrub.hash);
-    subRd.SetRelativeOrigin(foundShrub->offset);
-    IGHW tieData;
-    tieData.FromStream(subRd, Version::V2);
-    const size_t nodeIndex =
-        ShrubToGltf(main, shaders, tieData, shdStream, main.materialRemaps);
-    main.shrubs[shrub.hash].nodeIndex = nodeIndex;
-  }
+  ConvertRegionAssets(
+      shrubStream, shrubLookups, shrubs, main.shrubs, [&](IGHW &data) {
+        return ShrubToGltf(main, shaders, data, shdStream, main.materialRemaps);
+      });
 }
 
 void GatherRegionFoliages(
-    IMGLTF &main, AppContext *ctx,
-    IGHWTOCIteratorConst<ResourceShaders> &shaders, AppContextStream &shdStream,
-    IGHWTOCIteratorConst<ResourceFoliages> foliages,
+    IMGLTF &main, AppContext *ctx, const ShaderIndex &shaders,
+    AppContextStream &shdStream,
+    const ResourceIndex<ResourceFoliages> &foliages,
     IGHWTOCIteratorConst<FoliageV2Instance> foliageInstances,
     IGHWTOCIteratorConst<ZoneFoliageLookup> foliageLookups,
     const std::string &workDir) {
@@ -793,33 +841,21 @@ void GatherRegionFoliages(
   }
 
   auto foliageStream = ctx->RequestFile(workDir + "foliages.dat");
-  BinReaderRef_e subRd(*foliageStream.Get());
-
-  for (auto &foliage : foliageLookups) {
-    if (main.foliages[foliage.hash].nodeIndex > -1) {
-      continue;
-    }
-    auto foundFoliage =
-        std::find(foliages.begin(), foliages.end(), foliage.hash);
-    subRd.SetRelativeOrigin(foundFoliage->offset);
-    IGHW tieData;
-    tieData.FromStream(subRd, Version::V2);
-    const size_t nodeIndex =
-        FoliageToGltf(main, shaders, tieData, shdStream, main.materialRemaps);
-    main.foliages[foliage.hash].nodeIndex = nodeIndex;
-  }
+  ConvertRegionAssets(
+      foliageStream, foliageLookups, foliages, main.foliages,
+      [&](IGHW &data) {
+        return FoliageToGltf(main, shaders, data, shdStream,
+                             main.materialRemaps);
+      });
 }
 
-void RegionToGltf(IMGLTF &main, IGHW &ighw,
-                  IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                  AppContextStream &shdStream,
-                  IGHWTOCIteratorConst<ResourceTies> ties,
-                  IGHWTOCIteratorConst<ResourceShrubs> shrubs,
-                  IGHWTOCIteratorConst<ResourceFoliages> foliages,
+void RegionToGltf(IMGLTF &main, IGHW &ighw, IGHWWindowReader &buffers,
+                  const ShaderIndex &shaders, AppContextStream &shdStream,
+                  const ResourceIndex<ResourceTies> &ties,
+                  const ResourceIndex<ResourceShrubs> &shrubs,
+                  const ResourceIndex<ResourceFoliages> &foliages,
                   AppContext *ctx, const std::string &workDir) {
   IGHWTOCIteratorConst<RegionMeshV2> meshes;
-  IGHWTOCIteratorConst<RegionVertexBuffer> vtxBuffer;
-  IGHWTOCIteratorConst<RegionIndexBuffer> idxBuffer;
   IGHWTOCIteratorConst<ZoneShaderLookup> shaderLookups;
   IGHWTOCIteratorConst<TieInstanceV2> tieInstances;
   IGHWTOCIteratorConst<ZoneTieLookup> tieLookups;
@@ -827,14 +863,17 @@ void RegionToGltf(IMGLTF &main, IGHW &ighw,
   IGHWTOCIteratorConst<ShrubV2Instance> shrubInstances;
   IGHWTOCIteratorConst<FoliageV2Instance> foliageInstances;
   IGHWTOCIteratorConst<ZoneFoliageLookup> foliageLookups;
-  CatchClasses(ighw, meshes, vtxBuffer, idxBuffer, shaders, tieInstances,
-               tieLookups, shrubLookups, shrubInstances, shaderLookups,
-               foliageInstances, foliageLookups);
+  CatchClasses(ighw, meshes, tieInstances, tieLookups, shrubLookups,
+               shrubInstances, shaderLookups, foliageInstances, foliageLookups);
   ShadersToGltf(main, shaderLookups, shaders, shdStream, main.materialRemaps);
 
   if (meshes.Valid()) {
-    const uint16 *indexBuffer = &idxBuffer.at(0).data;
-    const char *vertexBuffer = &vtxBuffer.at(0).data;
+    auto vtxBuffer = buffers.Find(RegionVertexBuffer::ID);
+    auto idxBuffer = buffers.Find(RegionIndexBuffer::ID);
+
+    if (!vtxBuffer || !idxBuffer) {
+      throw std::runtime_error("Missing region vertex or index buffer");
+    }
 
     main.scenes.front().nodes.emplace_back(main.nodes.size());
     gltf::Node &glNode = main.nodes.emplace_back();
@@ -847,11 +886,8 @@ void RegionToGltf(IMGLTF &main, IGHW &ighw,
       glPrim.material =
           main.materialRemaps.at(shaderLookups.at(item.materialIndex).hash);
 
-      const uint16 *indices = indexBuffer + item.indexOffset / 2;
-      const RegionVertexV2 *vertices = reinterpret_cast<const RegionVertexV2 *>(
-          vertexBuffer + item.vertexOffset);
-
-      std::vector<RegionVertexV2> vtx0(vertices, vertices + item.numVerties);
+      std::vector<RegionVertexV2> vtx0 = buffers.Read<RegionVertexV2>(
+          *vtxBuffer, item.vertexOffset, item.numVerties);
 
       for (auto &v : vtx0) {
         FByteswapper(v);
@@ -888,7 +924,8 @@ void RegionToGltf(IMGLTF &main, IGHW &ighw,
       glPrim.attributes = main.SaveVertices(vtx0.data(), vtx0.size(), attrs,
                                             sizeof(RegionVertexV2));
 
-      std::vector<uint16> idx(indices, indices + item.numIndices);
+      std::vector<uint16> idx = buffers.Read<uint16>(
+          *idxBuffer, item.indexOffset / 2 * sizeof(uint16), item.numIndices);
       for (uint16 &i : idx) {
         FByteswapper(i);
       }
@@ -927,17 +964,16 @@ void GenerateInstances(IMGLTF &main) {
   }
 }
 
-void RegionToGltf(IGHW &ighw, AppContext *ctx,
-                  IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                  AppContextStream &shdStream,
-                  IGHWTOCIteratorConst<ResourceTies> ties,
-                  IGHWTOCIteratorConst<ResourceShrubs> shrubs,
-                  IGHWTOCIteratorConst<ResourceFoliages> foliages,
-                  AFileInfo zonePath) {
+GltfOutput RegionToGltf(IGHW &ighw, IGHWWindowReader &buffers, AppContext *ctx,
+                        const ShaderIndex &shaders, AppContextStream &shdStream,
+                        const ResourceIndex<ResourceTies> &ties,
+                        const ResourceIndex<ResourceShrubs> &shrubs,
+                        const ResourceIndex<ResourceFoliages> &foliages,
+                        AFileInfo zonePath) {
   IMGLTF main;
-  RegionToGltf(main, ighw, shaders, shdStream, ties, shrubs, foliages, ctx,
-               std::string(ctx->workingFile.GetFolder()));
+  RegionToGltf(main, ighw, buffers, shaders, shdStream, ties, shrubs, foliages,
+               ctx, std::string(ctx->workingFile.GetFolder()));
   GenerateInstances(main);
 
-  main.FinishAndSave(ctx->NewFile(zonePath.ChangeExtension2("glb")).str, "");
+  return SaveGltf(main, zonePath.ChangeExtension2("glb"));
 }
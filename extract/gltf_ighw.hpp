@@ -1,6 +1,8 @@
 #pragma once
 #include "insomnia/insomnia.hpp"
+#include "insomnia/internal/resource_index.hpp"
 #include "spike/gltf.hpp"
+#include <shared_mutex>
 
 struct AppContextStream;
 struct AppContext;
@@ -41,11 +43,65 @@ private:
   int32 instScs = -1;
 };
 
-void RegionToGltf(IMGLTF &main, IGHW &ighw,
-                  IGHWTOCIteratorConst<ResourceShaders> &shaders,
-                  AppContextStream &shdStream,
-                  IGHWTOCIteratorConst<ResourceTies> ties,
-                  IGHWTOCIteratorConst<ResourceShrubs> shrubs,
-                  IGHWTOCIteratorConst<ResourceFoliages> foliages,
+// Converted file, written by caller.
+// Lets workers convert assets while output order stays deterministic.
+struct GltfOutput {
+  std::string path;
+  std::string data;
+};
+
+// Resolved shader data, only material name and texture hashes are kept.
+struct ShaderInfo {
+  std::string name;
+  std::vector<uint32> mapHashes;
+};
+
+// Shaders resolved so far from one shaders table.
+// Filled by ExtractShaders or on first request.
+struct ShaderCache {
+  // Loads MaterialResourceNameLookup from shdStream when not cached.
+  // Returns nullptr when hash is not within shaders.
+  const ShaderInfo *Get(Hash hash,
+                        const ResourceIndex<ResourceShaders> &shaders,
+                        AppContextStream &shdStream);
+  void Insert(Hash hash, ShaderInfo info);
+
+private:
+  std::shared_mutex mutex;
+  // Nodes are never erased, returned pointers stay valid
+  std::map<Hash, ShaderInfo> items;
+};
+
+// Shaders table of assetlookup, shared by all converters of that file.
+// Resolved shaders are cached per table, so lookups of other files
+// never get them.
+struct ShaderIndex : ResourceIndex<ResourceShaders> {
+  using ResourceIndex<ResourceShaders>::ResourceIndex;
+
+  const ShaderInfo *Get(Hash hash, AppContextStream &shdStream) const {
+    return cache.Get(hash, *this, shdStream);
+  }
+
+  void Insert(Hash hash, ShaderInfo info) const {
+    cache.Insert(hash, std::move(info));
+  }
+
+private:
+  mutable ShaderCache cache;
+};
+
+// Zone classes used by RegionToGltf.
+// Vertex and index buffers are read through IGHWWindowReader.
+static constexpr uint32 REGION_CLASSES[]{
+    RegionMeshV2::ID,      ZoneShaderLookup::ID, TieInstanceV2::ID,
+    ZoneTieLookup::ID,     ZoneShrubLookup::ID,  ShrubV2Instance::ID,
+    FoliageV2Instance::ID, ZoneFoliageLookup::ID,
+};
+
+void RegionToGltf(IMGLTF &main, IGHW &ighw, IGHWWindowReader &buffers,
+                  const ShaderIndex &shaders, AppContextStream &shdStream,
+                  const ResourceIndex<ResourceTies> &ties,
+                  const ResourceIndex<ResourceShrubs> &shrubs,
+                  const ResourceIndex<ResourceFoliages> &foliages,
                   AppContext *ctx, const std::string &workDir);
 void GenerateInstances(IMGLTF &main);
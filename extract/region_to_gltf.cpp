@@ -19,14 +19,30 @@
 #include "project.h"
 #include "spike/app_context.hpp"
 #include "spike/io/binreader_stream.hpp"
+#include "spike/master_printer.hpp"
+#include "spike/reflect/reflector.hpp"
 
 std::string_view filters[]{
     "^region.dat$",
 };
 
+static struct Region2GLTF : ReflectorBase<Region2GLTF> {
+  uint32 bufferMemory = 64;
+  std::string cacheDir;
+} settings;
+
+REFLECT(CLASS(Region2GLTF),
+        MEMBERNAME(bufferMemory, "buffer-memory", "m",
+                   ReflDesc{"Memory limit for cached vertex and index data "
+                            "in MiB."}),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Keep fixed up copy of asset lookup in this "
+                            "folder for next runs."}), );
+
 static AppInfo_s appInfo{
     .header = Region2GLTF_DESC " v" Region2GLTF_VERSION
                                ", " Region2GLTF_COPYRIGHT "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -40,11 +56,6 @@ void AppProcessFile(AppContext *ctx) {
 
   IGHWTOCIteratorConst<ZoneHash> zoneHashes;
   IGHWTOCIteratorConst<ZoneNameLookup> zoneNames;
-  IGHWTOCIteratorConst<ResourceShaders> shaders;
-  IGHWTOCIteratorConst<ResourceZones> zones;
-  IGHWTOCIteratorConst<ResourceTies> ties;
-  IGHWTOCIteratorConst<ResourceShrubs> shrubs;
-  IGHWTOCIteratorConst<ResourceFoliages> foliages;
 
   CatchClasses(region, zoneHashes, zoneNames);
   std::string_view thisDir = ctx->workingFile.GetFolder();
@@ -55,16 +66,37 @@ void AppProcessFile(AppContext *ctx) {
   auto streamZones = ctx->RequestFile(mainDir + "zones.dat");
   auto streamAssetLookup = ctx->RequestFile(mainDir + "assetlookup.dat");
   IGHW lookup;
-  lookup.FromStream(*streamAssetLookup.Get(), Version::V2);
-  CatchClasses(lookup, shaders, zones, ties, shrubs, foliages);
+
+  if (!lookup.FromCache(settings.cacheDir, mainDir + "assetlookup.dat", 0, 0,
+                        Version::V2)) {
+    lookup.FromStream(*streamAssetLookup.Get(), Version::V2);
+  }
+  const ShaderIndex shaders(lookup.TryIter<ResourceShaders>());
+  const ResourceIndex zones(lookup.TryIter<ResourceZones>());
+  const ResourceIndex ties(lookup.TryIter<ResourceTies>());
+  const ResourceIndex shrubs(lookup.TryIter<ResourceShrubs>());
+  const ResourceIndex foliages(lookup.TryIter<ResourceFoliages>());
 
   for (auto &z : zoneHashes) {
-    auto foundZone = std::find(zones.begin(), zones.end(), z.hash);
-    streamZones->seekg(foundZone->offset);
+    const ResourceZones *foundZone = zones.Find(z.hash);
+
+    if (!foundZone) {
+      PrintWarning("Zone ", z.hash.part1, ":", z.hash.part2,
+                   " not found in asset lookup, skipped");
+      continue;
+    }
+
+    BinReaderRef_e zoneRd(*streamZones.Get());
+    zoneRd.SetRelativeOrigin(foundZone->offset);
     IGHW zone;
-    zone.FromStream(*streamZones.Get(), Version::V2);
-    RegionToGltf(main, zone, shaders, shdStream, ties, shrubs, foliages, ctx,
-                 mainDir);
+    zone.FromStream(zoneRd, Version::V2, REGION_CLASSES);
+    IGHWWindowReader buffers;
+    buffers.memoryLimit = size_t(settings.bufferMemory) << 20;
+    streamZones->seekg(foundZone->offset);
+    buffers.FromStream(*streamZones.Get());
+
+    RegionToGltf(main, zone, buffers, shaders, shdStream, ties, shrubs,
+                 foliages, ctx, mainDir);
   }
 
   GenerateInstances(main);
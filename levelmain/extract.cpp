@@ -17,6 +17,8 @@
 
 #include "glm/gtx/quaternion.hpp"
 #include "insomnia/insomnia.hpp"
+#include "insomnia/internal/texel_cache.hpp"
+#include "insomnia/internal/texture.hpp"
 #include "insomnia/internal/vertex.hpp"
 #include "nlohmann/json.hpp"
 #include "project.h"
@@ -34,14 +36,65 @@ std::string_view filters[]{
     "^ps3levelmain.dat$",
 };
 
+MAKE_ENUM(ENUMSCOPE(class TextureMode, TextureMode), EMEMBER(PNG),
+          EMEMBER(DDS), EMEMBER(DDSWithPNG))
+
+static struct LevelmainToGLTF : ReflectorBase<LevelmainToGLTF> {
+  uint32 bufferMemory = 64;
+  TextureMode textureMode = TextureMode::PNG;
+  std::string cacheDir;
+} settings;
+
+REFLECT(CLASS(LevelmainToGLTF),
+        MEMBERNAME(bufferMemory, "buffer-memory", "m",
+                   ReflDesc{"Memory limit for cached vertex and index data "
+                            "in MiB."}),
+        MEMBERNAME(textureMode, "texture-mode", "t",
+                   ReflDesc{"Format of embedded textures. DDS keeps BC "
+                            "textures without swizzle as is "
+                            "(MSFT_texture_dds), DDSWithPNG adds PNG fallback "
+                            "for viewers without DDS support."}),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Keep converted textures in this folder for next "
+                            "runs and levels."}), );
+
 static AppInfo_s appInfo{
     .header = LevelmainToGLTF_DESC " v" LevelmainToGLTF_VERSION
                                    ", " LevelmainToGLTF_COPYRIGHT "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
 AppInfo_s *AppInitModule() { return &appInfo; }
 
+// Vertex and index buffers of ps3levelverts.dat, read on demand
+struct LevelBuffers {
+  IGHWWindowReader reader;
+  const IGHWWindowReader::Entry *indices = nullptr;
+  const IGHWWindowReader::Entry *vertices = nullptr;
+
+  std::vector<uint16> Indices(size_t index, size_t count) {
+    std::vector<uint16> retVal =
+        reader.Read<uint16>(*indices, index * sizeof(uint16), count);
+
+    for (uint16 &i : retVal) {
+      FByteswapper(i);
+    }
+
+    return retVal;
+  }
+
+  template <class V> std::vector<V> Vertices(size_t offset, size_t count) {
+    std::vector<V> retVal = reader.Read<V>(*vertices, offset, count);
+
+    for (V &v : retVal) {
+      FByteswapper(v);
+    }
+
+    return retVal;
+  }
+};
+
 struct IMGLTF : GLTFModel {
   GLTFStream &GetTranslations() {
     if (instTrs < 0) {
@@ -87,36 +140,27 @@ struct TextureKey {
   }
 };
 
-struct TexStream : TexelOutput {
-  GLTF &main;
-  GLTFStream *str = nullptr;
-  bool ignore = false;
-
-  TexStream(GLTF &main_) : main{main_} {}
-
-  void SendData(std::string_view data) override {
-    if (str) [[likely]] {
-      str->wr.WriteContainer(data);
-    }
-  }
-  void NewFile(std::string path) override {
-    if (ignore) {
-      return;
-    }
-
-    str = &main.NewStream(path);
-  }
-};
-
-void ExtractTexture(AppContext *ctx, std::string path,
-                    std::istream &textureStream, TextureKey &info,
-                    TexStream *texOut = nullptr) {
-  thread_local static std::string tmpBuffer(4 * 2048 * 2048, 0);
+// Texel data is stored in big endian 16bit words, decoder, emission check
+// and DDS output must agree on it.
+static constexpr bool SWAP_PACKED = true;
 
+std::string ReadTexture(std::istream &textureStream, const Texture &tex) {
+  std::string data;
+  data.resize(TexturePayloadSize(tex));
   textureStream.clear();
-  textureStream.seekg(info.tex->offset);
-  textureStream.read(tmpBuffer.data(), tmpBuffer.size());
+  textureStream.seekg(tex.offset);
+  textureStream.read(data.data(), data.size());
+  return data;
+}
 
+using TexelPostProcess = decltype(NewTexelContextCreate::postProcess);
+
+// Converted files are sent to texOut, as PNG when embedded into glTF.
+// Extract context is not touched.
+void ExtractTexture(AppContext *ctx, const std::string &path,
+                    std::string &data, const TextureKey &info,
+                    TexelOutput &texOut, bool embed,
+                    TexelPostProcess postProcess = {}) {
   TexelTile tile = TexelTile::Linear;
 
   auto GetFormat = [&] {
@@ -180,47 +224,195 @@ void ExtractTexture(AppContext *ctx, std::string path,
               .type = GetFormat(),
               .swizzle = swizzle,
               .tile = tile,
-              .swapPacked = true,
+              .swapPacked = SWAP_PACKED,
           },
       .depth = std::max(
           uint16(1), uint16(info.tex->control3.Get<TextureControl3::depth>())),
       .numMipmaps = uint8(info.tex->numMips),
-      .data = tmpBuffer.data(),
-      .texelOutput = texOut,
+      .data = data.data(),
+      .texelOutput = &texOut,
       .formatOverride =
-          texOut ? TexelContextFormat::UPNG : TexelContextFormat::Config,
+          embed ? TexelContextFormat::UPNG : TexelContextFormat::Config,
   };
 
-  auto EmissiveCheck = [texOut](char *data, uint32 stride, uint32 numTexels) {
-    texOut->ignore = true;
+  tctx.postProcess = std::move(postProcess);
+
+  if (embed) {
+    ctx->NewImage(tctx);
+  } else {
+    ctx->NewImage(path, tctx);
+  }
+}
+
+// Texture read and looked up in cache.
+// output holds final files when converted is set.
+struct PreparedTexture {
+  std::string data{};
+  uint64 cacheKey = 0;
+  bool converted = false;
+  TexelMemoryOutput output{};
+};
+
+// Embedded file names don't come from path
+static std::string CachePath(const std::string &path, bool embed) {
+  return embed ? std::string{} : path;
+}
+
+// Texel cache key part of output format, 0 when disabled.
+// Embedded images are always UPNG, texture mode doesn't change them.
+static uint64 OutputFormatKey(bool embed) {
+  if (settings.cacheDir.empty()) {
+    return 0;
+  }
+
+  return embed ? TexelOutputFormatKey(TexelContextFormat::UPNG, 0, true)
+               : TexelOutputFormatKey(TexelContextFormat::Config,
+                                      uint32(settings.textureMode), false);
+}
+
+// Doesn't call NewImage, safe to call from any thread.
+static PreparedTexture PrepareTexture(const std::string &path,
+                                      std::string data, const TextureKey &info,
+                                      bool embed) {
+  const TexelCache cache(settings.cacheDir);
+  PreparedTexture retVal{.data = std::move(data)};
+
+  if (cache.Enabled()) {
+    const Texture &tex = *info.tex;
+    const uint32 params[]{
+        uint32(tex.format),
+        tex.width,
+        tex.height,
+        tex.numMips,
+        uint32(tex.control3.Get<TextureControl3::depth>()),
+        uint32(info.normal) | info.gloss << 1 | info.specular << 2 |
+            info.emissive << 3,
+    };
+    retVal.cacheKey =
+        TexelCache::Key(retVal.data, OutputFormatKey(embed), params);
+    retVal.converted = cache.Load(retVal.cacheKey, CachePath(path, embed),
+                                  retVal.output);
+  }
+
+  return retVal;
+}
+
+// ExtractTexture backed by settings.cacheDir, image comes from
+// PrepareTexture. Calls NewImage, keep on writer thread.
+// Emissive textures without any emission produce no files.
+TexelMemoryOutput ExtractTextureCached(AppContext *ctx, const std::string &path,
+                                       PreparedTexture &image,
+                                       const TextureKey &info, bool embed) {
+  if (image.converted) {
+    return std::move(image.output);
+  }
+
+  const TexelCache cache(settings.cacheDir);
+  TexelMemoryOutput output;
+  bool isEmpty = false;
+
+  auto EmissiveCheck = [&isEmpty](char *data, uint32 stride,
+                                  uint32 numTexels) {
+    isEmpty = true;
     for (uint32 i = 0; i < numTexels; i++, data += stride) {
       if (*data) {
-        texOut->ignore = false;
+        isEmpty = false;
         return;
       }
     }
   };
 
-  if (info.emissive) {
-    tctx.postProcess = EmissiveCheck;
+  ExtractTexture(ctx, path, image.data, info, output, embed,
+                 info.emissive ? TexelPostProcess(EmissiveCheck)
+                               : TexelPostProcess{});
+
+  if (isEmpty) {
+    output.files.clear();
   }
 
-  if (texOut) {
-    ctx->NewImage(tctx);
-  } else {
-    ctx->ExtractContext()->NewImage(path + std::to_string(info.id), tctx);
+  cache.Store(image.cacheKey, CachePath(path, embed), output);
+  return output;
+}
+
+static void EmbedImage(GLTF &main, int32 image, TexelMemoryOutput &output) {
+  for (TexelMemoryOutput::File &file : output.files) {
+    GLTFStream &str = main.NewStream(file.path);
+    str.wr.WriteContainer(file.data);
+    main.images.at(image).bufferView = str.slot;
   }
 }
 
+// Texture waiting for conversion.
+// image is reserved glTF image slot, -1 for standalone file.
+// dds stores texture blocks without decoding, see IsDDSCompatible.
+struct TextureJob {
+  TextureKey key;
+  std::string path;
+  int32 image = -1;
+  bool dds = false;
+};
+
+// Jobs are converted in order of reserved slots.
+void ConvertTextures(AppContext *ctx, GLTF *main,
+                     const std::vector<TextureJob> &jobs,
+                     std::istream &textureStream) {
+  for (const TextureJob &job : jobs) {
+    std::string data = ReadTexture(textureStream, *job.key.tex);
+    PreparedTexture image;
+
+    if (job.dds) {
+      if (SWAP_PACKED) {
+        SwapPackedBlocks(data);
+      }
+      image.converted = true;
+      image.output.NewFile(job.path + ".dds");
+      image.output.SendData(DDSHeader(*job.key.tex));
+      image.output.SendData(data);
+    } else {
+      image = PrepareTexture(job.path, std::move(data), job.key,
+                             job.image >= 0);
+    }
+
+    TexelMemoryOutput output =
+        ExtractTextureCached(ctx, job.path, image, job.key, job.image >= 0);
+
+    if (job.image < 0) {
+      output.Flush(ctx->ExtractContext());
+      continue;
+    }
+
+    EmbedImage(*main, job.image, output);
+  }
+}
+
+// DDS only textures have no core source, extension is required for them.
+static void UseDDSExtension(GLTF &main) {
+  static constexpr std::string_view EXT = "MSFT_texture_dds";
+
+  if (!std::ranges::count(main.extensionsUsed, EXT)) {
+    main.extensionsUsed.emplace_back(EXT);
+  }
+
+  if (settings.textureMode == TextureMode::DDS &&
+      !std::ranges::count(main.extensionsRequired, EXT)) {
+    main.extensionsRequired.emplace_back(EXT);
+  }
+}
+
+// Emissive textures are checked and converted right away, empty ones are
+// not used.
+// Rest get their image slots reserved and conversion is queued into jobs.
 int32 TryExtractTexture(AppContext *ctx, GLTF &main, TextureKey key,
                         const Texture *textures, std::istream &textureStream,
-                        std::set<TextureKey> &textureRemaps) {
+                        std::set<TextureKey> &textureRemaps,
+                        std::vector<TextureJob> &jobs) {
   if (auto found = textureRemaps.find(key); found != textureRemaps.end()) {
     return found->id;
   }
 
+  const int32 textureIndex = main.textures.size();
   gltf::Texture glTexture{};
-  glTexture.source = main.textures.size();
+  glTexture.source = main.images.size();
   gltf::Image glImage{};
   glImage.mimeType = "image/png";
   glImage.name = "texture_" + std::to_string(std::distance(textures, key.tex));
@@ -229,29 +421,65 @@ int32 TryExtractTexture(AppContext *ctx, GLTF &main, TextureKey key,
     glImage.name.append("_e");
   }
 
-  TexStream tStr{main};
+  key.id = textureIndex;
 
-  ExtractTexture(ctx, glImage.name, textureStream, key, &tStr);
+  if (!key.emissive) {
+    textureRemaps.emplace(key);
+    // Swizzled maps must be decoded
+    const bool asDDS = settings.textureMode != TextureMode::PNG &&
+                       !key.normal && !key.gloss && IsDDSCompatible(*key.tex);
+
+    if (asDDS) {
+      UseDDSExtension(main);
+      gltf::Image ddsImage{};
+      ddsImage.mimeType = "image/vnd-ms.dds";
+      ddsImage.name = glImage.name;
+      glTexture.GetExtensionsAndExtras()["extensions"]["MSFT_texture_dds"]
+               ["source"] = main.images.size();
+      jobs.push_back({key, glImage.name, int32(main.images.size()), true});
+      main.images.emplace_back(ddsImage);
+      glTexture.source = -1;
+    }
 
-  if (!tStr.str) {
+    if (!asDDS || settings.textureMode == TextureMode::DDSWithPNG) {
+      glTexture.source = main.images.size();
+      jobs.push_back({key, glImage.name, int32(main.images.size())});
+      main.images.emplace_back(glImage);
+    }
+
+    main.textures.emplace_back(glTexture);
+    return textureIndex;
+  }
+
+  std::string data = ReadTexture(textureStream, *key.tex);
+  TexelMemoryOutput output;
+
+  // Most special maps carry no emission, skip decode for them
+  if (HasNonZeroBlue(*key.tex, data, SWAP_PACKED)) {
+    PreparedTexture image =
+        PrepareTexture(glImage.name, std::move(data), key, true);
+    output = ExtractTextureCached(ctx, glImage.name, image, key, true);
+  }
+
+  if (output.files.empty()) {
     key.id = -1;
     textureRemaps.emplace(key);
     return -1;
   }
 
-  key.id = glTexture.source;
   textureRemaps.emplace(key);
-  glImage.bufferView = tStr.str->slot;
   main.textures.emplace_back(glTexture);
   main.images.emplace_back(glImage);
-  return glTexture.source;
+  EmbedImage(main, glTexture.source, output);
+  return textureIndex;
 }
 
 void MakeMaterials(AppContext *ctx, IMGLTF &main,
                    const std::map<uint16, uint16> &materialRemaps,
                    IGHWTOCIteratorConst<MaterialV1> materials,
                    const Texture *textures, std::istream &textureStream,
-                   std::set<TextureKey> &textureRemaps) {
+                   std::set<TextureKey> &textureRemaps,
+                   std::vector<TextureJob> &jobs) {
   main.materials.resize(materialRemaps.size());
 
   for (auto [mid, mindex] : materialRemaps) {
@@ -265,7 +493,7 @@ void MakeMaterials(AppContext *ctx, IMGLTF &main,
         .albedo = true,
     };
     glMat.pbrMetallicRoughness.baseColorTexture.index = TryExtractTexture(
-        ctx, main, albedoInfo, textures, textureStream, textureRemaps);
+        ctx, main, albedoInfo, textures, textureStream, textureRemaps, jobs);
 
     if (mat.blendMode == 4) {
       glMat.alphaMode = gltf::Material::AlphaMode::Mask;
@@ -285,7 +513,7 @@ void MakeMaterials(AppContext *ctx, IMGLTF &main,
       };
 
       glMat.normalTexture.index = TryExtractTexture(
-          ctx, main, normalInfo, textures, textureStream, textureRemaps);
+          ctx, main, normalInfo, textures, textureStream, textureRemaps, jobs);
     }
 
     const Texture *special = mat.textures[2];
@@ -301,7 +529,7 @@ void MakeMaterials(AppContext *ctx, IMGLTF &main,
         };
 
         int32 specId = TryExtractTexture(ctx, main, specInfo, textures,
-                                         textureStream, textureRemaps);
+                                         textureStream, textureRemaps, jobs);
 
         if (mat.useSpecular) {
           nlohmann::json &spec =
@@ -321,7 +549,7 @@ void MakeMaterials(AppContext *ctx, IMGLTF &main,
       };
 
       glMat.emissiveTexture.index = TryExtractTexture(
-          ctx, main, emisKey, textures, textureStream, textureRemaps);
+          ctx, main, emisKey, textures, textureStream, textureRemaps, jobs);
     }
   }
 }
@@ -329,7 +557,8 @@ void MakeMaterials(AppContext *ctx, IMGLTF &main,
 void MakeFoliageMaterials(AppContext *ctx, IMGLTF &main,
                           const std::map<uint16, uint16> &materialRemaps,
                           const Texture *textures, std::istream &textureStream,
-                          std::set<TextureKey> &textureRemaps) {
+                          std::set<TextureKey> &textureRemaps,
+                          std::vector<TextureJob> &jobs) {
   main.materials.resize(materialRemaps.size() + main.materials.size());
 
   for (auto [mid, mindex] : materialRemaps) {
@@ -342,7 +571,7 @@ void MakeFoliageMaterials(AppContext *ctx, IMGLTF &main,
         .albedo = true,
     };
     glMat.pbrMetallicRoughness.baseColorTexture.index = TryExtractTexture(
-        ctx, main, albedoInfo, textures, textureStream, textureRemaps);
+        ctx, main, albedoInfo, textures, textureStream, textureRemaps, jobs);
     glMat.alphaMode = gltf::Material::AlphaMode::Mask;
   }
 }
@@ -611,8 +840,10 @@ std::set<TextureKey> MobyToGltf(const MobyV1 &moby, AppContext *ctx,
   MobyToGltf(moby, main, stream, materialRemaps);
 
   std::set<TextureKey> textureRemaps;
+  std::vector<TextureJob> jobs;
   MakeMaterials(ctx, main, materialRemaps, materials, textures,
-                stream.BaseStream(), textureRemaps);
+                stream.BaseStream(), textureRemaps, jobs);
+  ConvertTextures(ctx, &main, jobs, stream.BaseStream());
 
   main.FinishAndSave(ctx->NewFile(std::string(ctx->workingFile.GetFolder()) +
                                   "moby_" + std::to_string(moby.mobyId) +
@@ -623,14 +854,9 @@ std::set<TextureKey> MobyToGltf(const MobyV1 &moby, AppContext *ctx,
   return textureRemaps;
 }
 
-void TieToGltf(const TieV1 &tie, IMGLTF &level,
-               const LevelIndexBuffer &idxBuffer,
-               const LevelVertexBuffer &vtxBuffer,
+void TieToGltf(const TieV1 &tie, IMGLTF &level, LevelBuffers &buffers,
                IGHWTOCIteratorConst<TieInstanceV1> tieInstances, uint32 index,
                std::map<uint16, uint16> &materialRemaps) {
-  const uint16 *indexBuffer = &idxBuffer.data;
-  const char *vertexBuffer = &vtxBuffer.data;
-
   level.scenes.front().nodes.emplace_back(level.nodes.size());
   gltf::Node &glNode = level.nodes.emplace_back();
   glNode.mesh = level.meshes.size();
@@ -646,16 +872,8 @@ void TieToGltf(const TieV1 &tie, IMGLTF &level,
         materialRemaps.try_emplace(prim.materialIndex, materialRemaps.size())
             .first->second;
 
-    const uint16 *indices = indexBuffer + prim.indexOffset;
-    const Vertex0 *vertices =
-        reinterpret_cast<const Vertex0 *>(vertexBuffer + tie.unk13) +
-        prim.vertexOffset0;
-
-    std::vector<Vertex0> vtx0(vertices, vertices + prim.numVertices);
-
-    for (auto &v : vtx0) {
-      FByteswapper(v);
-    }
+    std::vector<Vertex0> vtx0 = buffers.Vertices<Vertex0>(
+        tie.unk13 + prim.vertexOffset0 * sizeof(Vertex0), prim.numVertices);
 
     Attribute attrs[]{
         {
@@ -679,10 +897,8 @@ void TieToGltf(const TieV1 &tie, IMGLTF &level,
     glPrim.attributes =
         level.SaveVertices(vtx0.data(), vtx0.size(), attrs, sizeof(Vertex0));
 
-    std::vector<uint16> idx(indices, indices + prim.numIndices);
-    for (uint16 &i : idx) {
-      FByteswapper(i);
-    }
+    std::vector<uint16> idx =
+        buffers.Indices(prim.indexOffset, prim.numIndices);
 
     glPrim.indices = level.SaveIndices(idx.data(), idx.size()).accessorIndex;
   }
@@ -758,13 +974,9 @@ void TieToGltf(const TieV1 &tie, IMGLTF &level,
 }
 
 void DetailToGltf(const DetailCluster &detailCluster, IMGLTF &level,
-                  const LevelIndexBuffer &idxBuffer,
-                  const LevelVertexBuffer &vtxBuffer,
+                  LevelBuffers &buffers,
                   IGHWTOCIteratorConst<DetailInstance> detailInstances,
                   uint32 index, std::map<uint16, uint16> &materialRemaps) {
-  const uint16 *indexBuffer = &idxBuffer.data;
-  const char *vertexBuffer = &vtxBuffer.data;
-
   level.scenes.front().nodes.emplace_back(level.nodes.size());
   gltf::Node &glNode = level.nodes.emplace_back();
   glNode.mesh = level.meshes.size();
@@ -780,15 +992,8 @@ void DetailToGltf(const DetailCluster &detailCluster, IMGLTF &level,
 
     AttributeMul attributeMul{prim.meshScale * 0x7fff};
 
-    const uint16 *indices = indexBuffer + prim.indexOffset;
-    const Vertex0 *vertices = reinterpret_cast<const Vertex0 *>(
-        vertexBuffer + prim.vertexBufferOffset);
-
-    std::vector<Vertex0> vtx0(vertices, vertices + prim.numVertices);
-
-    for (auto &v : vtx0) {
-      FByteswapper(v);
-    }
+    std::vector<Vertex0> vtx0 =
+        buffers.Vertices<Vertex0>(prim.vertexBufferOffset, prim.numVertices);
 
     Attribute attrs[]{
         {
@@ -812,10 +1017,8 @@ void DetailToGltf(const DetailCluster &detailCluster, IMGLTF &level,
     glPrim.attributes =
         level.SaveVertices(vtx0.data(), vtx0.size(), attrs, sizeof(Vertex0));
 
-    std::vector<uint16> idx(indices, indices + prim.numIndices);
-    for (uint16 &i : idx) {
-      FByteswapper(i);
-    }
+    std::vector<uint16> idx =
+        buffers.Indices(prim.indexOffset, prim.numIndices);
 
     glPrim.indices = level.SaveIndices(idx.data(), idx.size()).accessorIndex;
   }
@@ -891,12 +1094,8 @@ void DetailToGltf(const DetailCluster &detailCluster, IMGLTF &level,
 }
 
 void RegionToGltf(IGHWTOCIteratorConst<RegionMesh> items, IMGLTF &level,
-                  const LevelIndexBuffer &idxBuffer,
-                  const LevelVertexBuffer &vtxBuffer,
+                  LevelBuffers &buffers,
                   std::map<uint16, uint16> &materialRemaps) {
-  const uint16 *indexBuffer = &idxBuffer.data;
-  const char *vertexBuffer = &vtxBuffer.data;
-
   level.scenes.front().nodes.emplace_back(level.nodes.size());
   gltf::Node &glNode = level.nodes.emplace_back();
   glNode.mesh = level.meshes.size();
@@ -909,15 +1108,8 @@ void RegionToGltf(IGHWTOCIteratorConst<RegionMesh> items, IMGLTF &level,
         materialRemaps.try_emplace(item.materialIndex, materialRemaps.size())
             .first->second;
 
-    const uint16 *indices = indexBuffer + item.indexOffset;
-    const RegionVertex *vertices = reinterpret_cast<const RegionVertex *>(
-        vertexBuffer + item.vertexOffset);
-
-    std::vector<RegionVertex> vtx0(vertices, vertices + item.numVerties);
-
-    for (auto &v : vtx0) {
-      FByteswapper(v);
-    }
+    std::vector<RegionVertex> vtx0 =
+        buffers.Vertices<RegionVertex>(item.vertexOffset, item.numVerties);
 
     AttributeMad attributeMad;
     attributeMad.mul = (Vector4A16(0x7fff) / 0x100) * YARD_TO_M;
@@ -950,24 +1142,16 @@ void RegionToGltf(IGHWTOCIteratorConst<RegionMesh> items, IMGLTF &level,
     glPrim.attributes = level.SaveVertices(vtx0.data(), vtx0.size(), attrs,
                                            sizeof(RegionVertex));
 
-    std::vector<uint16> idx(indices, indices + item.numIndices);
-    for (uint16 &i : idx) {
-      FByteswapper(i);
-    }
+    std::vector<uint16> idx =
+        buffers.Indices(item.indexOffset, item.numIndices);
 
     glPrim.indices = level.SaveIndices(idx.data(), idx.size()).accessorIndex;
   }
 }
 
-void FoliageToGltf(const Foliage &foliage, IMGLTF &level,
-                   const LevelIndexBuffer &idxBuffer,
-                   const LevelVertexBuffer &vtxBuffer,
+void FoliageToGltf(const Foliage &foliage, IMGLTF &level, LevelBuffers &buffers,
                    IGHWTOCIteratorConst<FoliageInstance> instances,
                    std::map<uint16, uint16> &materialRemaps, uint32 index) {
-  const uint16 *indexBuffer = &idxBuffer.data;
-  const char *vertexBuffer = &vtxBuffer.data;
-
-  const uint16 *indices = indexBuffer + foliage.indexOffset;
   const uint32 numVertices =
       (foliage.spriteVertexOffset - foliage.branchVertexOffset) /
       sizeof(BranchVertex);
@@ -978,17 +1162,12 @@ void FoliageToGltf(const Foliage &foliage, IMGLTF &level,
   glFoliageNode.name = "Foliage" + std::to_string(index);
 
   if (numVertices) {
-    const BranchVertex *vertices = reinterpret_cast<const BranchVertex *>(
-        vertexBuffer + foliage.branchVertexOffset);
-    std::vector<BranchVertex> vtx0(vertices, vertices + numVertices);
+    std::vector<BranchVertex> vtx0 = buffers.Vertices<BranchVertex>(
+        foliage.branchVertexOffset, numVertices);
 
     glFoliageNode.mesh = level.meshes.size();
     gltf::Mesh &glMesh = level.meshes.emplace_back();
 
-    for (auto &v : vtx0) {
-      FByteswapper(v);
-    }
-
     AttributeUnormToSnorm sn;
     AttributeMul attributeMul(YARD_TO_M);
 
@@ -1028,11 +1207,8 @@ void FoliageToGltf(const Foliage &foliage, IMGLTF &level,
       gltf::Primitive &glPrim = glMesh.primitives.emplace_back();
       glPrim.attributes = attrsa;
 
-      std::vector<uint16> idx(indices + r.indexOffset,
-                              indices + r.numIndices + r.indexOffset);
-      for (uint16 &i : idx) {
-        FByteswapper(i);
-      }
+      std::vector<uint16> idx = buffers.Indices(
+          foliage.indexOffset + r.indexOffset, r.numIndices);
 
       glPrim.material =
           materialRemaps
@@ -1129,20 +1305,16 @@ void FoliageToGltf(const Foliage &foliage, IMGLTF &level,
         uint32 unk;
       };
 
-      std::vector<uint16> idx(indices + r.indexBegin, indices + r.indexEnd);
+      std::vector<uint16> idx = buffers.Indices(
+          foliage.indexOffset + r.indexBegin, r.indexEnd - r.indexBegin);
       uint16 numVertices = 0;
       for (uint16 &i : idx) {
-        FByteswapper(i);
         numVertices = std::max(i, numVertices);
       }
       numVertices++;
 
-      const SpriteVertex *vertices = reinterpret_cast<const SpriteVertex *>(
-          vertexBuffer + foliage.spriteVertexOffset);
-      std::vector<SpriteVertex> inVerts(vertices, vertices + numVertices);
-      for (SpriteVertex &i : inVerts) {
-        FByteswapper(i);
-      }
+      std::vector<SpriteVertex> inVerts = buffers.Vertices<SpriteVertex>(
+          foliage.spriteVertexOffset, numVertices);
       std::vector<SpriteVertexOut> outVerts;
 
       const Vector4 *centers = reinterpret_cast<const Vector4 *>(
@@ -1217,6 +1389,8 @@ void ExtractTextures(AppContext *ctx, std::string path,
                      IGHWTOCIteratorConst<Texture> textures,
                      std::istream &textureStream,
                      std::set<TextureKey> totalTextures = {}) {
+  std::vector<TextureJob> jobs;
+
   for (uint16 index = 0; const Texture &tex : textures) {
     TextureKey info{
         .tex = &tex,
@@ -1224,15 +1398,16 @@ void ExtractTextures(AppContext *ctx, std::string path,
     };
 
     if (totalTextures.count(info) == 0) {
-      ExtractTexture(ctx, path, textureStream, info);
+      jobs.push_back({info, path + std::to_string(info.id)});
     }
   }
+
+  ConvertTextures(ctx, nullptr, jobs, textureStream);
 }
 
 void ShrubsToGltf(const Shrubs &shrubInstances,
                   const IGHWTOCIteratorConst<Shrub> shrubs, IMGLTF &level,
-                  const LevelIndexBuffer &idxBuffer,
-                  const LevelVertexBuffer &vtxBuffer,
+                  LevelBuffers &buffers,
                   std::map<uint16, uint16> &materialRemaps) {
 
   std::vector<Vector> posByShrub[16];
@@ -1264,11 +1439,8 @@ void ShrubsToGltf(const Shrubs &shrubInstances,
   }
 
   for (uint32 index = 0; auto &shrub : shrubs) {
-    const uint16 *indices = &idxBuffer.data + shrub.indexOffset;
-    std::vector<uint16> idx(indices, indices + shrub.numIndices);
-    for (uint16 &i : idx) {
-      FByteswapper(i);
-    }
+    std::vector<uint16> idx =
+        buffers.Indices(shrub.indexOffset, shrub.numIndices);
 
     level.scenes.front().nodes.emplace_back(level.nodes.size());
     auto &glNode = level.nodes.emplace_back();
@@ -1284,13 +1456,8 @@ void ShrubsToGltf(const Shrubs &shrubInstances,
         materialRemaps.try_emplace(shrub.materialIndex, materialRemaps.size())
             .first->second;
 
-    const ShrubVertex *vertices = reinterpret_cast<const ShrubVertex *>(
-        &vtxBuffer.data + shrub.vertexBufferOffset);
-    std::vector<ShrubVertex> vtx0(vertices, vertices + numVertices);
-
-    for (auto &v : vtx0) {
-      FByteswapper(v);
-    }
+    std::vector<ShrubVertex> vtx0 =
+        buffers.Vertices<ShrubVertex>(shrub.vertexBufferOffset, numVertices);
 
     AttributeMul attributeMul(YARD_TO_M);
 
@@ -1452,11 +1619,15 @@ void AppProcessFile(AppContext *ctx) {
   IGHWTOCIteratorConst<Shrub> shrubs;
   auto txStr = ctx->RequestFile(workFolder + "ps3leveltexs.dat");
   auto vtxStr = ctx->RequestFile(workFolder + "ps3levelverts.dat");
-  IGHW buffers;
-  buffers.FromStream(*vtxStr.Get(), Version::RFOM);
-  IGHWTOCIteratorConst<LevelVertexBuffer> verts;
-  IGHWTOCIteratorConst<LevelIndexBuffer> indices;
-  CatchClasses(buffers, verts, indices);
+  LevelBuffers buffers;
+  buffers.reader.memoryLimit = size_t(settings.bufferMemory) << 20;
+  buffers.reader.FromStream(*vtxStr.Get());
+  buffers.vertices = buffers.reader.Find(LevelVertexBuffer::ID);
+  buffers.indices = buffers.reader.Find(LevelIndexBuffer::ID);
+
+  if (!buffers.vertices || !buffers.indices) {
+    throw std::runtime_error("Missing level vertex or index buffer");
+  }
   CatchClasses(main, mobys, ties, tieInstances, regionMeshes, lightmaps,
                textures, blendMaps, materials, detailClusters, detailInstances,
                foliages, foliageInstances, shrubs, shrubInstances);
@@ -1483,21 +1654,19 @@ void AppProcessFile(AppContext *ctx) {
     std::map<uint16, uint16> foliageRemaps;
 
     for (size_t tieIdx = 0; const TieV1 &tie : ties) {
-      TieToGltf(tie, level, indices.at(0), verts.at(0), tieInstances, tieIdx++,
-                materialRemaps);
+      TieToGltf(tie, level, buffers, tieInstances, tieIdx++, materialRemaps);
     }
 
-    RegionToGltf(regionMeshes, level, indices.at(0), verts.at(0),
-                 materialRemaps);
+    RegionToGltf(regionMeshes, level, buffers, materialRemaps);
 
     for (size_t tieIdx = 0; const DetailCluster &item : detailClusters) {
-      DetailToGltf(item, level, indices.at(0), verts.at(0), detailInstances,
-                   tieIdx++, materialRemaps);
+      DetailToGltf(item, level, buffers, detailInstances, tieIdx++,
+                   materialRemaps);
     }
 
     if (shrubInstances.Valid()) {
-      ShrubsToGltf(shrubInstances.at(0), shrubs, level, indices.at(0),
-                   verts.at(0), materialRemaps);
+      ShrubsToGltf(shrubInstances.at(0), shrubs, level, buffers,
+                   materialRemaps);
     }
 
     if (gpStr) {
@@ -1505,16 +1674,18 @@ void AppProcessFile(AppContext *ctx) {
     }
 
     std::set<TextureKey> textureRemaps;
+    std::vector<TextureJob> textureJobs;
     MakeMaterials(ctx, level, materialRemaps, materials, textures.begin(),
-                  txRd.BaseStream(), textureRemaps);
+                  txRd.BaseStream(), textureRemaps, textureJobs);
 
     for (size_t folIdx = 0; const Foliage &foliage : foliages) {
-      FoliageToGltf(foliage, level, indices.at(0), verts.at(0),
-                    foliageInstances, foliageRemaps, folIdx++);
+      FoliageToGltf(foliage, level, buffers, foliageInstances, foliageRemaps,
+                    folIdx++);
     }
 
     MakeFoliageMaterials(ctx, level, foliageRemaps, textures.begin(),
-                         txRd.BaseStream(), textureRemaps);
+                         txRd.BaseStream(), textureRemaps, textureJobs);
+    ConvertTextures(ctx, &level, textureJobs, txRd.BaseStream());
 
     totalTextures.merge(textureRemaps);
     level.FinishAndSave(ctx->NewFile(workFolder + "level.glb").str, "");